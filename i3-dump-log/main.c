@@ -13,9 +13,13 @@
 #include "shmlog.h"
 
 #include <err.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <i3/ipc.h>
+#include <inttypes.h>
+#include <locale.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -24,11 +28,17 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 static uint32_t wrap_count;
 
 static i3_shmlog_header *header;
@@ -72,6 +82,320 @@ static void print_till_end(void) {
     walk += len;
 }
 
+/*
+ * Returns true if the given position of a binary log holds a plausible record
+ * which ends before |end|.
+ *
+ */
+static bool record_valid(const char *pos, const char *end) {
+    i3_shmlog_record record;
+    if (pos + sizeof(i3_shmlog_record) > end) {
+        return false;
+    }
+    memcpy(&record, pos, sizeof(i3_shmlog_record));
+    /* Messages are limited to 4 KiB by i3. */
+    if (record.length > 4096 ||
+        pos + SHMLOG_ALIGN(sizeof(i3_shmlog_record) + record.length) > end) {
+        return false;
+    }
+    return (record.format_id == 0 ||
+            (record.format_id >= header->offset_formats &&
+             record.format_id < header->offset_formats + header->formats_size &&
+             (record.format_id % SHMLOG_ALIGNMENT) == 0));
+}
+
+/*
+ * Formats the given record of a binary log (see shmlog.h) and prints it to
+ * stdout.
+ *
+ */
+static void print_record(const char *pos) {
+    i3_shmlog_record record;
+    memcpy(&record, pos, sizeof(i3_shmlog_record));
+    const char *payload = pos + sizeof(i3_shmlog_record);
+    const char *payload_end = payload + record.length;
+
+    if (record.format_id == 0) {
+        fwrite(payload, record.length, 1, stdout);
+        return;
+    }
+
+    /* Same prefix as in i3’s src/log.c vlog() */
+    char prefix[64];
+    struct tm result;
+    const time_t t = record.time;
+    if (strftime(prefix, sizeof(prefix), "%x %X - ", localtime_r(&t, &result)) > 0) {
+        fputs(prefix, stdout);
+    }
+
+#define READ(value)                                    \
+    do {                                               \
+        if (payload + sizeof(value) > payload_end) {   \
+            fputs("<truncated log record>\n", stdout); \
+            return;                                    \
+        }                                              \
+        memcpy(&(value), payload, sizeof(value));      \
+        payload += sizeof(value);                      \
+    } while (0)
+
+#define PRINT_CONVERSION(value)                      \
+    do {                                             \
+        if (conv.stars == 0) {                       \
+            printf(spec, value);                     \
+        } else if (conv.stars == 1) {                \
+            printf(spec, stars[0], value);           \
+        } else {                                     \
+            printf(spec, stars[0], stars[1], value); \
+        }                                            \
+    } while (0)
+
+    const char *fmt = logbuffer + record.format_id + sizeof(uint32_t);
+    const char *walk = fmt;
+    const char *next;
+    printf_conversion_t conv;
+    while ((next = next_printf_conversion(walk, &conv)) != NULL) {
+        fwrite(walk, next - walk, 1, stdout);
+        walk = next + conv.length;
+
+        int stars[2] = {0, 0};
+        for (int i = 0; i < conv.stars && i < 2; i++) {
+            int64_t star;
+            READ(star);
+            stars[i] = star;
+        }
+
+        /* Rebuild the conversion, using "ll" as length modifier for all
+         * integers: i3 already converted them to the right type. */
+        char spec[64];
+        if (conv.modifier_offset + 4 > sizeof(spec) || conv.type == PRINTF_ARG_UNSUPPORTED) {
+            fwrite(next, conv.length, 1, stdout);
+            continue;
+        }
+        memcpy(spec, next, conv.modifier_offset);
+        size_t spec_len = conv.modifier_offset;
+        if (conv.type == PRINTF_ARG_SIGNED || conv.type == PRINTF_ARG_UNSIGNED) {
+            spec[spec_len++] = 'l';
+            spec[spec_len++] = 'l';
+        }
+        spec[spec_len++] = conv.conversion;
+        spec[spec_len] = '\0';
+
+        switch (conv.type) {
+            case PRINTF_ARG_NONE:
+                fputc('%', stdout);
+                break;
+            case PRINTF_ARG_SIGNED: {
+                int64_t value;
+                READ(value);
+                PRINT_CONVERSION((long long)value);
+                break;
+            }
+            case PRINTF_ARG_UNSIGNED: {
+                uint64_t value;
+                READ(value);
+                PRINT_CONVERSION((unsigned long long)value);
+                break;
+            }
+            case PRINTF_ARG_CHAR: {
+                int64_t value;
+                READ(value);
+                PRINT_CONVERSION((int)value);
+                break;
+            }
+            case PRINTF_ARG_DOUBLE: {
+                double value;
+                READ(value);
+                PRINT_CONVERSION(value);
+                break;
+            }
+            case PRINTF_ARG_POINTER: {
+                uint64_t value;
+                READ(value);
+                PRINT_CONVERSION((void *)(uintptr_t)value);
+                break;
+            }
+            case PRINTF_ARG_STRING: {
+                uint32_t length;
+                READ(length);
+                if (length == UINT32_MAX) {
+                    PRINT_CONVERSION((const char *)NULL);
+                    break;
+                }
+                if (payload + length > payload_end) {
+                    fputs("<truncated log record>\n", stdout);
+                    return;
+                }
+                char *str = sstrndup(payload, length);
+                payload += length;
+                PRINT_CONVERSION(str);
+                free(str);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    fputs(walk, stdout);
+
+#undef PRINT_CONVERSION
+#undef READ
+}
+
+/*
+ * Copies the header, retrying until the copy is consistent (see
+ * i3_shmlog_header.sequence).
+ *
+ */
+static void read_header(i3_shmlog_header *copy) {
+    for (;;) {
+        const uint32_t sequence = __atomic_load_n(&(header->sequence), __ATOMIC_SEQ_CST);
+        if ((sequence % 2) == 0) {
+            memcpy(copy, header, sizeof(i3_shmlog_header));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&(header->sequence), __ATOMIC_SEQ_CST) == sequence) {
+                return;
+            }
+        }
+        sched_yield();
+    }
+}
+
+/* A copy of the record which is being printed. i3 might overwrite the
+ * original at any time. */
+static char record_copy[sizeof(i3_shmlog_record) + 4096];
+
+/*
+ * Copies the record with the given sequence number at pos into record_copy.
+ * Returns false if that record is not (or no longer) at pos.
+ *
+ */
+static bool copy_record(const char *pos, const char *end, uint64_t sequence) {
+    i3_shmlog_record record;
+    if (!record_valid(pos, end)) {
+        return false;
+    }
+    memcpy(&record, pos, sizeof(i3_shmlog_record));
+    if (record.sequence != sequence) {
+        return false;
+    }
+    memcpy(record_copy, pos, sizeof(i3_shmlog_record) + record.length);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    /* i3 updates oldest_record before overwriting a record. */
+    return (__atomic_load_n(&(header->oldest_record), __ATOMIC_SEQ_CST) <= sequence);
+}
+
+/*
+ * Prints the records of a SHMLOG_FORMAT_BINARY log, starting with the record
+ * numbered *sequence at *pos, up to (excluding) the record numbered |until|.
+ * Afterwards, *pos and *sequence refer to the next record.
+ *
+ */
+static void print_records(const char **pos, uint64_t *sequence, uint64_t until) {
+    const char *ring_start = logbuffer + SHMLOG_ALIGN(sizeof(i3_shmlog_header));
+    const char *ring_end = logbuffer + header->offset_formats;
+
+    while (*sequence < until) {
+        if (copy_record(*pos, ring_end, *sequence)) {
+            print_record(record_copy);
+
+            i3_shmlog_record record;
+            memcpy(&record, record_copy, sizeof(i3_shmlog_record));
+            *pos += SHMLOG_ALIGN(sizeof(i3_shmlog_record) + record.length);
+            (*sequence)++;
+            continue;
+        }
+
+        if (*pos != ring_start && copy_record(ring_start, ring_end, *sequence)) {
+            /* i3 wrapped around after the previous record. */
+            *pos = ring_start;
+            continue;
+        }
+
+        /* i3 overwrote the record before we could read it. Continue with
+         * the oldest record that is left. */
+        i3_shmlog_header snapshot;
+        read_header(&snapshot);
+        if (snapshot.oldest_record > *sequence) {
+            printf("[i3-dump-log: %" PRIu64 " log messages were overwritten before they could be read]\n",
+                   snapshot.oldest_record - *sequence);
+            *sequence = snapshot.oldest_record;
+            *pos = logbuffer + snapshot.offset_oldest;
+        } else {
+            /* Should not happen, but make sure we do not loop forever. */
+            printf("[i3-dump-log: cannot read log message %" PRIu64 "]\n", *sequence);
+            *sequence = snapshot.next_record;
+            *pos = logbuffer + snapshot.offset_next_write;
+            return;
+        }
+    }
+}
+
+/*
+ * Dumps a SHMLOG_FORMAT_BINARY log, formatting the log messages. Returns the
+ * sequence number of the next record, which will be written at *pos.
+ *
+ */
+static uint64_t dump_binary_log(const char **pos) {
+    i3_shmlog_header snapshot;
+    read_header(&snapshot);
+
+    uint64_t sequence = snapshot.oldest_record;
+    *pos = logbuffer + snapshot.offset_oldest;
+    print_records(pos, &sequence, snapshot.next_record);
+    fflush(stdout);
+    return sequence;
+}
+
+#if defined(__linux__)
+/*
+ * Returns true if the SHM log was removed (i3 exited or SHM logging was
+ * turned off) or replaced (e.g. by shmlog <size>).
+ *
+ */
+static bool shmlog_gone(const char *shmname, ino_t ino) {
+    struct stat statbuf;
+    int fd = shm_open(shmname, O_RDONLY, 0);
+    if (fd == -1) {
+        return true;
+    }
+    const bool gone = (fstat(fd, &statbuf) != 0 || statbuf.st_ino != ino);
+    close(fd);
+    return gone;
+}
+
+/*
+ * Prints new records of a SHMLOG_FORMAT_BINARY log as they appear, like
+ * tail -f. Instead of polling, this waits for i3 to wake us up via futex(2).
+ *
+ */
+static void follow_binary_log(const char *shmname, ino_t ino, const char *pos, uint64_t sequence) {
+    for (;;) {
+        const uint32_t seen = __atomic_load_n(&(header->sequence), __ATOMIC_SEQ_CST);
+        const uint64_t next = __atomic_load_n(&(header->next_record), __ATOMIC_SEQ_CST);
+        if (next > sequence) {
+            print_records(&pos, &sequence, next);
+            fflush(stdout);
+            continue;
+        }
+
+        /* i3 only wakes readers if there are any, so announce ourselves
+         * before checking (again) whether anything changed. */
+        __atomic_add_fetch(&(header->waiters), 1, __ATOMIC_SEQ_CST);
+        long ret = 0;
+        if (__atomic_load_n(&(header->sequence), __ATOMIC_SEQ_CST) == seen) {
+            /* Wake up regularly to notice when i3 exits. */
+            const struct timespec timeout = {.tv_sec = 1, .tv_nsec = 0};
+            ret = syscall(SYS_futex, &(header->sequence), FUTEX_WAIT, seen, &timeout, NULL, 0);
+        }
+        __atomic_sub_fetch(&(header->waiters), 1, __ATOMIC_SEQ_CST);
+
+        if (ret == -1 && errno == ETIMEDOUT && shmlog_gone(shmname, ino)) {
+            exit(0);
+        }
+    }
+}
+#endif
+
 void errorlog(char *fmt, ...) {
     va_list args;
 
@@ -180,7 +504,8 @@ int main(int argc, char *argv[]) {
 
     struct stat statbuf;
 
-    /* NB: While we must never write, we need O_RDWR for the pthread condvar. */
+    /* NB: The only write is to the |waiters| field of the header when
+     * following a binary log (see follow_binary_log()). */
     int logbuffer_shm = shm_open(shmname, O_RDWR, 0);
     if (logbuffer_shm == -1) {
         err(EXIT_FAILURE, "Could not shm_open SHM segment for the i3 log (%s)", shmname);
@@ -190,7 +515,7 @@ int main(int argc, char *argv[]) {
         err(EXIT_FAILURE, "stat(%s)", shmname);
     }
 
-    logbuffer = mmap(NULL, statbuf.st_size, PROT_READ, MAP_SHARED, logbuffer_shm, 0);
+    logbuffer = mmap(NULL, statbuf.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, logbuffer_shm, 0);
     if (logbuffer == MAP_FAILED) {
         err(EXIT_FAILURE, "Could not mmap SHM segment for the i3 log");
     }
@@ -198,10 +523,29 @@ int main(int argc, char *argv[]) {
     header = (i3_shmlog_header *)logbuffer;
 
     if (verbose) {
-        printf("next_write = %d, last_wrap = %d, logbuffer_size = %d, shmname = %s\n",
-               header->offset_next_write, header->offset_last_wrap, header->size, shmname);
+        printf("next_write = %d, last_wrap = %d, logbuffer_size = %d, format = %d, shmname = %s\n",
+               header->offset_next_write, header->offset_last_wrap, header->size, header->format, shmname);
+    }
+
+    if (header->format == SHMLOG_FORMAT_BINARY) {
+        /* Format timestamps like i3 does. */
+        setlocale(LC_TIME, "");
+        const char *pos;
+        const uint64_t sequence = dump_binary_log(&pos);
+#if defined(__linux__)
+        if (follow) {
+            follow_binary_log(shmname, statbuf.st_ino, pos, sequence);
+        }
+#else
+        (void)sequence;
+#endif
+        free(shmname);
+        goto follow;
+    } else if (header->format != SHMLOG_FORMAT_TEXT) {
+        errx(EXIT_FAILURE, "Unknown SHM log format %d, is i3-dump-log older than i3?", header->format);
     }
     free(shmname);
+
     walk = logbuffer + header->offset_next_write;
 
     /* We first need to print old content in case there was at least one
@@ -225,6 +569,7 @@ int main(int argc, char *argv[]) {
     walk = logbuffer + sizeof(i3_shmlog_header);
     print_till_end();
 
+follow:
 #if !defined(__OpenBSD__)
     if (!follow) {
         return 0;
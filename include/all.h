@@ -33,6 +33,7 @@
 #include <xcb/xcb_keysyms.h>
 
 #include "libi3.h"
+#include "hashmap.h"
 #include "data.h"
 #include "util.h"
 #include "ipc.h"
@@ -11,6 +11,13 @@
 
 #include <config.h>
 
+/**
+ * (Re-)builds the index of all assignments. Needs to be called whenever the
+ * list of assignments changed, i.e. after (re-)loading the configuration.
+ *
+ */
+void reindex_assignments(void);
+
 /**
  * Checks the list of assignments for the given window and runs all matching
  * ones (unless they have already been run for this specific window).
@@ -13,6 +13,10 @@
 
 #include <config.h>
 
+/** All marks of all containers, in the order they were set. */
+TAILQ_HEAD(all_marks_head, mark_t);
+extern struct all_marks_head all_marks;
+
 /**
  * Create a new container (and attach it to the given parent, if not NULL).
  * This function only initializes the data structures.
@@ -201,6 +205,44 @@ bool con_exists(Con *con);
  */
 Con *con_by_frame_id(xcb_window_t frame);
 
+/**
+ * Sets the client window of the given container (window may be NULL) and
+ * updates the index used by con_by_window_id() accordingly. Must be called
+ * while the previous window (if any) has not been freed yet.
+ *
+ */
+void con_set_window(Con *con, i3Window *window);
+
+/**
+ * Marks the workspace of the given container as changed, so that the next
+ * tree_render() pushes it to X11 even if it is not visible. Invisible
+ * workspaces which were not marked are skipped entirely.
+ *
+ */
+void con_mark_dirty(Con *con);
+
+/**
+ * Returns true if rendering and pushing the given container can be skipped,
+ * that is, if it is a workspace which is not visible and which was not changed
+ * since the last tree_render() (see con_mark_dirty()).
+ *
+ */
+bool con_is_render_clean(Con *con);
+
+/**
+ * Adds the frame of the given container to the index used by
+ * con_by_frame_id(). Called by x_con_init() once the frame was created.
+ *
+ */
+void con_index_frame(Con *con);
+
+/**
+ * Removes the frame of the given container from the index used by
+ * con_by_frame_id(). Called by x_con_kill() and x_con_reframe().
+ *
+ */
+void con_unindex_frame(Con *con);
+
 /**
  * Returns the container with the given mark or NULL if no such container
  * exists.
@@ -478,6 +478,9 @@ struct Window {
 
     /** When this window was marked urgent. 0 means not urgent */
     struct timeval urgent;
+    /** Urgent windows are kept in a list ordered by urgent, see
+     * window_set_urgent(). */
+    TAILQ_ENTRY(Window) urgent_windows;
 
     /** Pixels the window reserves. left/right/top/bottom */
     struct reservedpx reserved;
@@ -626,6 +629,9 @@ struct Assignment {
         char *output;
     } dest;
 
+    /** position in the list of assignments, set by reindex_assignments() */
+    int position;
+
     TAILQ_ENTRY(Assignment) assignments;
 };
 
@@ -638,6 +644,7 @@ struct mark_t {
     char *name;
 
     TAILQ_ENTRY(mark_t) marks;
+    TAILQ_ENTRY(mark_t) all_marks;
 };
 
 /**
@@ -647,6 +654,11 @@ struct mark_t {
 struct Con {
     bool mapped;
 
+    /** Only applicable for containers of type CT_WORKSPACE: whether the
+     * workspace needs to be rendered and pushed to X11 even though it is not
+     * visible. Set by con_mark_dirty(), reset by tree_render(). */
+    bool dirty;
+
     /* Should this container be marked urgent? This gets set when the window
      * inside this container (if any) sets the urgency hint, for example. */
     bool urgent;
@@ -662,6 +674,17 @@ struct Con {
     surface_t frame;
     surface_t frame_buffer;
     bool pixmap_recreated;
+    /* Set to a new value whenever frame_buffer is (re)created. The values are
+     * unique across all containers, see x_push_node(). */
+    uint32_t frame_buffer_generation;
+
+    /* Children of stacked/tabbed containers render their title bar into this
+     * pixmap, which is then copied into the parent's frame_buffer. This way,
+     * a title bar only needs to be rendered again if it changed itself. */
+    surface_t deco_buffer;
+    /* The parent's frame_buffer_generation at the time deco_buffer was last
+     * copied into the parent's frame_buffer. */
+    uint32_t deco_buffer_generation;
 
     enum {
         CT_ROOT = 0,
@@ -809,4 +832,20 @@ struct Con {
 
     /* The colormap for this con if a custom one is used. */
     xcb_colormap_t colormap;
+
+    /** The tree generation in which the fields that dump_node() writes for
+     * this container (not including its children) last changed, and a
+     * fingerprint of these fields to detect the next change. Maintained by
+     * the GET_TREE_CHANGES IPC message, see ipc.c. */
+    uint64_t generation;
+    uint64_t fingerprint;
+
+    /** The JSON which dump_node() last generated for this container and its
+     * children, and the fingerprint of the subtree at that time. The JSON is
+     * reused as long as the subtree fingerprint stays the same. */
+    char *json_cache;
+    size_t json_cache_length;
+    uint64_t json_cache_fingerprint;
+    /* Only valid during dump_node(). */
+    uint64_t subtree_fingerprint;
 };
@@ -0,0 +1,75 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * hashmap.c: Open-addressing hash tables used to index containers (and other
+ *            objects) by X11 IDs, pointers or names.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+/**
+ * A hash table mapping integer keys (X11 IDs, pointers) to non-NULL values.
+ * A zero-initialized struct hashmap is a valid, empty table.
+ *
+ */
+struct hashmap_entry {
+    uint64_t key;
+    void *value;
+};
+
+struct hashmap {
+    struct hashmap_entry *entries;
+    /* Always zero or a power of two. */
+    size_t capacity;
+    size_t count;
+};
+
+/**
+ * Returns the value stored for the given key or NULL if there is none.
+ *
+ */
+void *hashmap_get(const struct hashmap *map, uint64_t key);
+
+/**
+ * Stores the given (non-NULL) value for the given key, replacing any value
+ * which was previously stored for it.
+ *
+ */
+void hashmap_put(struct hashmap *map, uint64_t key, void *value);
+
+/**
+ * Removes the given key from the table. Returns the value that was stored
+ * for it or NULL if there was none.
+ *
+ */
+void *hashmap_remove(struct hashmap *map, uint64_t key);
+
+/**
+ * Frees all memory used by the table. The values themselves are not freed.
+ *
+ */
+void hashmap_free(struct hashmap *map);
+
+/**
+ * Like hashmap_get(), but for tables keyed by strings. A table must either
+ * only be used with the *_string functions or only with the others.
+ *
+ */
+void *hashmap_get_string(const struct hashmap *map, const char *key);
+
+/**
+ * Like hashmap_put(), but for tables keyed by strings. The key is copied.
+ *
+ */
+void hashmap_put_string(struct hashmap *map, const char *key, void *value);
+
+/**
+ * Like hashmap_remove(), but for tables keyed by strings.
+ *
+ */
+void *hashmap_remove_string(struct hashmap *map, const char *key);
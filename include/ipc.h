@@ -23,12 +23,34 @@
 
 extern char *current_socketpath;
 
+/**
+ * A complete IPC message (header and payload). Messages are immutable once
+ * created and reference counted, so that an event can be queued for all
+ * subscribed clients without copying it.
+ *
+ */
+typedef struct ipc_message_buffer {
+    int refcount;
+    size_t size;
+    uint8_t data[];
+} ipc_message_buffer;
+
+/**
+ * An entry in a client's output queue.
+ *
+ */
+typedef struct ipc_output_segment {
+    ipc_message_buffer *message;
+
+    TAILQ_ENTRY(ipc_output_segment) segments;
+} ipc_output_segment;
+
 typedef struct ipc_client {
     int fd;
 
-    /* The events which this client wants to receive */
-    int num_events;
-    char **events;
+    /* The events which this client wants to receive, as a bitmask of
+     * (1 << (event type & ~I3_IPC_EVENT_MASK)). */
+    uint32_t events;
 
     /* For clients which subscribe to the tick event: whether the first tick
      * event has been sent by i3. */
@@ -37,8 +59,11 @@ typedef struct ipc_client {
     struct ev_io *read_callback;
     struct ev_io *write_callback;
     struct ev_timer *timeout;
-    uint8_t *buffer;
-    size_t buffer_size;
+
+    /* Messages which still need to be written to the client. The first
+     * output_offset bytes of the first message were already written. */
+    TAILQ_HEAD(ipc_output_head, ipc_output_segment) output;
+    size_t output_offset;
 
     TAILQ_ENTRY(ipc_client) clients;
 } ipc_client;
@@ -85,7 +110,7 @@ ipc_client *ipc_new_client_on_fd(EV_P_ int fd);
  * and subscribed to this kind of event.
  *
  */
-void ipc_send_event(const char *event, uint32_t message_type, const char *payload);
+void ipc_send_event(uint32_t message_type, const char *payload);
 
 /**
  * Calls to ipc_shutdown() should provide a reason for the shutdown.
@@ -106,6 +131,13 @@ void ipc_shutdown(shutdown_reason_t reason, int exempt_fd);
 
 void dump_node(yajl_gen gen, Con *con, bool inplace_restart);
 
+/**
+ * Records that the given container is about to be freed, so that clients of
+ * GET_TREE_CHANGES learn about its removal.
+ *
+ */
+void ipc_forget_con(Con *con);
+
 /**
  * Generates a json workspace event. Returns a dynamically allocated yajl
  * generator. Free with yajl_gen_free().
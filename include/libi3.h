@@ -80,6 +80,12 @@ struct Font {
 
             /** Font table for this font (may be NULL) */
             xcb_charinfo_t *table;
+
+            /** Width of every character of the Basic Multilingual Plane,
+             * indexed by (byte1 << 8) | byte2. Allocated on the first
+             * measurement and, if there is no font table, filled lazily by
+             * querying the server (may be NULL). */
+            int16_t *widths;
         } xcb;
 
         /** The pango font description */
@@ -686,3 +692,63 @@ bool is_background_set(xcb_connection_t *conn, xcb_screen_t *screen);
  *
  */
 bool boolstr(const char *str);
+
+/**
+ * The type of the argument consumed by a printf conversion, see
+ * next_printf_conversion().
+ *
+ */
+typedef enum {
+    /* %% */
+    PRINTF_ARG_NONE = 0,
+    PRINTF_ARG_SIGNED,
+    PRINTF_ARG_UNSIGNED,
+    PRINTF_ARG_CHAR,
+    PRINTF_ARG_DOUBLE,
+    PRINTF_ARG_STRING,
+    PRINTF_ARG_POINTER,
+    PRINTF_ARG_UNSUPPORTED
+} printf_arg_type_t;
+
+typedef enum {
+    PRINTF_LENGTH_NONE = 0,
+    PRINTF_LENGTH_HH,
+    PRINTF_LENGTH_H,
+    PRINTF_LENGTH_L,
+    PRINTF_LENGTH_LL,
+    PRINTF_LENGTH_Z,
+    PRINTF_LENGTH_J,
+    PRINTF_LENGTH_T,
+    PRINTF_LENGTH_LONG_DOUBLE
+} printf_length_t;
+
+/**
+ * A single conversion specification (e.g. "%-5.*s") of a printf format
+ * string.
+ *
+ */
+typedef struct printf_conversion_t {
+    /* Length of the whole conversion specification, including the '%'. */
+    size_t length;
+    /* Offset (from the '%') of the length modifier, or of the conversion
+     * character if there is none. */
+    size_t modifier_offset;
+    /* Number of '*' field widths/precisions, each consuming an int. */
+    int stars;
+    /* The literal precision, -1 if there is none or -2 if it is a '*' (i.e.
+     * the last of the stars). */
+    int precision;
+    printf_length_t length_modifier;
+    char conversion;
+    printf_arg_type_t type;
+} printf_conversion_t;
+
+/**
+ * Finds the next conversion specification (e.g. "%-5.*s") in the given printf
+ * format string and describes it in *conv. Returns a pointer to its '%', or
+ * NULL if there are no more conversions. Conversions which cannot be passed
+ * through a binary log (e.g. %n, %m or long double) have the type
+ * PRINTF_ARG_UNSUPPORTED.
+ *
+ */
+const char *next_printf_conversion(const char *fmt, printf_conversion_t *conv);
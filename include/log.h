@@ -23,11 +23,54 @@
 #if defined(DLOG)
 #undef DLOG
 #endif
+
+/**
+ * Subsystems whose debug messages can be enabled separately (see -d). A file
+ * selects its category by defining I3_LOG_CATEGORY before including all.h.
+ *
+ */
+typedef enum {
+    LOG_CATEGORY_GENERAL = 0,
+    LOG_CATEGORY_BINDINGS,
+    LOG_CATEGORY_CONFIG,
+    LOG_CATEGORY_EVENTS,
+    LOG_CATEGORY_IPC,
+    LOG_CATEGORY_MATCH,
+    LOG_CATEGORY_RANDR,
+    LOG_CATEGORY_RENDER,
+    LOG_CATEGORY_COUNT
+} log_category_t;
+
+#if !defined(I3_LOG_CATEGORY)
+#define I3_LOG_CATEGORY LOG_CATEGORY_GENERAL
+#endif
+
+/**
+ * Bitmask of the categories whose debug messages are currently logged, or 0
+ * if debug messages are neither printed nor stored in the SHM log.
+ *
+ */
+extern uint32_t debuglog_mask;
+
+/** Checked by DLOG() before any of its arguments are evaluated. When building
+ * with -Ddlog=false, DLOG() compiles to nothing (the arguments are still type
+ * checked). */
+#if defined(I3_DISABLE_DLOG)
+#define DLOG_ENABLED(category) false
+#else
+#define DLOG_ENABLED(category) ((debuglog_mask & (UINT32_C(1) << (category))) != 0)
+#endif
+
 /** ##__VA_ARGS__ means: leave out __VA_ARGS__ completely if it is empty, that
    is, delete the preceding comma */
 #define LOG(fmt, ...) verboselog(fmt, ##__VA_ARGS__)
 #define ELOG(fmt, ...) errorlog("ERROR: " fmt, ##__VA_ARGS__)
-#define DLOG(fmt, ...) debuglog("%s:%s:%d - " fmt, __FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__)
+#define DLOG(fmt, ...)                                                                    \
+    do {                                                                                  \
+        if (DLOG_ENABLED(I3_LOG_CATEGORY)) {                                              \
+            debuglog("%s:%s:%d - " fmt, __FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__); \
+        }                                                                                 \
+    } while (0)
 
 extern char *errorfilename;
 extern char *shmlogname;
@@ -65,6 +108,21 @@ bool get_debug_logging(void);
  */
 void set_debug_logging(const bool _debug_logging);
 
+/**
+ * Restricts debug logging to the given comma-separated list of categories
+ * (e.g. "bindings,ipc"), or enables all categories for "all". Returns false
+ * if the list contains an unknown category.
+ *
+ */
+bool set_debug_categories(const char *categories);
+
+/**
+ * Sets the format of the SHM log (SHMLOG_FORMAT_TEXT or SHMLOG_FORMAT_BINARY).
+ * An already open SHM log is re-created in the new format.
+ *
+ */
+void set_shmlog_format(uint32_t format);
+
 /**
  * Set verbosity of i3. If verbose is set to true, informative messages will
  * be printed to stdout. If verbose is set to false, only errors will be
@@ -13,9 +13,9 @@
 
 /**
  * Creates a new 'regex' struct containing the given pattern and a PCRE
- * compiled regular expression. Also, calls pcre_study because this regex will
- * most likely be used often (like for every new window and on every relevant
- * property change of existing windows).
+ * compiled regular expression. Also, JIT-compiles the regular expression
+ * because it will most likely be used often (like for every new window and on
+ * every relevant property change of existing windows).
  *
  * Returns NULL if the pattern could not be compiled into a regular expression
  * (and ELOGs an appropriate error message).
@@ -35,4 +35,83 @@ typedef struct i3_shmlog_header {
      * coincidentally be exactly the same as previously). Overflows can happen
      * and don’t matter — clients use an equality check (==). */
     uint32_t wrap_count;
+
+    /* The format (and version) of the log contents, one of SHMLOG_FORMAT_*.
+     * Zero (SHMLOG_FORMAT_TEXT) for compatibility with older versions. */
+    uint32_t format;
+
+    /* SHMLOG_FORMAT_BINARY only: byte offset of the table of format strings.
+     * The ring buffer of records ends here. */
+    uint32_t offset_formats;
+
+    /* SHMLOG_FORMAT_BINARY only: number of bytes used in the table of format
+     * strings. */
+    uint32_t formats_size;
+
+    /* Incremented by i3 before and after each write to the log, i.e. it is
+     * odd while a write is in progress. Readers which copy the header (or a
+     * record) and see the same even value before and after know that their
+     * copy is consistent. Also used as futex(2) word: i3 wakes all waiters
+     * after each write. */
+    uint32_t sequence;
+
+    /* The number of readers currently waiting on |sequence|. i3 only calls
+     * futex(2) if there are any. */
+    uint32_t waiters;
+
+    /* SHMLOG_FORMAT_BINARY only: byte offset of the oldest record which was
+     * not (partially) overwritten yet. */
+    uint32_t offset_oldest;
+
+    /* SHMLOG_FORMAT_BINARY only: sequence number of the oldest record which
+     * was not (partially) overwritten yet. Updated by i3 before overwriting a
+     * record, so a reader which copied a record with a sequence number of at
+     * least oldest_record (checked after copying) has an intact copy. */
+    uint64_t oldest_record;
+
+    /* SHMLOG_FORMAT_BINARY only: sequence number of the next record. */
+    uint64_t next_record;
 } i3_shmlog_header;
+
+/* The log contains the formatted log messages as plain text. */
+#define SHMLOG_FORMAT_TEXT 0
+
+/* The log contains i3_shmlog_record entries, which i3-dump-log formats when
+ * reading the log. */
+#define SHMLOG_FORMAT_BINARY 1
+
+/* Records (and the table of format strings) start at multiples of this. */
+#define SHMLOG_ALIGNMENT 8
+#define SHMLOG_ALIGN(offset) (((offset) + (SHMLOG_ALIGNMENT - 1)) & ~(SHMLOG_ALIGNMENT - 1))
+
+/**
+ * Header of each record in a SHMLOG_FORMAT_BINARY log. The first record starts
+ * at SHMLOG_ALIGN(sizeof(i3_shmlog_header)), each record is followed by
+ * |length| bytes of payload and padding up to SHMLOG_ALIGNMENT.
+ *
+ * If |format_id| is 0, the payload is the formatted message (including the
+ * time prefix). Otherwise, the format string is stored at byte offset
+ * |format_id| of the log (prefixed by its length as an uint32_t, including the
+ * trailing NUL byte), and the payload contains the arguments for each
+ * conversion of the format string, in order:
+ *
+ *   - each '*' field width or precision: int64_t
+ *   - integer conversions: int64_t/uint64_t, already converted to the type
+ *     implied by the length modifier (%hhx stores an unsigned char)
+ *   - %c: int64_t
+ *   - floating point conversions: double
+ *   - %p: uint64_t
+ *   - %s: uint32_t length (UINT32_MAX for NULL), followed by that many bytes
+ *     (already limited to the precision, if any)
+ *
+ * All values are stored unaligned in native byte order.
+ *
+ */
+typedef struct i3_shmlog_record {
+    uint32_t format_id;
+    uint32_t length;
+    /* Seconds since the epoch. */
+    int64_t time;
+    /* Records are numbered consecutively, starting at 0. */
+    uint64_t sequence;
+} i3_shmlog_record;
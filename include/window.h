@@ -17,6 +17,27 @@
  */
 void window_free(i3Window *win);
 
+/**
+ * Marks the given window as urgent (now) or clears its urgency and updates
+ * the list of urgent windows accordingly.
+ *
+ */
+void window_set_urgent(i3Window *win, bool urgent);
+
+/**
+ * Returns the window which was marked urgent most recently or NULL if no
+ * window is urgent.
+ *
+ */
+i3Window *window_latest_urgent(void);
+
+/**
+ * Returns the window which was marked urgent first or NULL if no window is
+ * urgent.
+ *
+ */
+i3Window *window_oldest_urgent(void);
+
 /**
  * Updates the WM_CLASS (consisting of the class and instance) for the
  * given window.
@@ -31,6 +31,20 @@
  */
 extern char *previous_workspace_name;
 
+/**
+ * Adds the given workspace to the name/number index. Called by con_attach()
+ * for every workspace which is attached to a content container.
+ *
+ */
+void workspace_index_add(Con *ws);
+
+/**
+ * Removes the given workspace from the name/number index. Called by
+ * con_detach() for workspaces.
+ *
+ */
+void workspace_index_remove(Con *ws);
+
 /**
  * Returns the workspace with the given name or NULL if such a workspace does
  * not exist.
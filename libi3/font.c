@@ -10,12 +10,13 @@
 #include <assert.h>
 #include <cairo/cairo-xcb.h>
 #include <err.h>
+#include <glib.h>
 #include <pango/pangocairo.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-static const i3Font *savedFont = NULL;
+static i3Font *savedFont = NULL;
 
 static xcb_visualtype_t *root_visual_type;
 static double pango_font_red;
@@ -23,6 +24,37 @@ static double pango_font_green;
 static double pango_font_blue;
 static double pango_font_alpha;
 
+/* The context in which text is measured. It is created along with the first
+ * Pango font and kept around, so that a measurement does not need to create a
+ * surface, a cairo context and a layout each time. */
+static cairo_surface_t *measure_surface;
+static cairo_t *measure_cr;
+static PangoLayout *measure_layout;
+
+/* Window titles, tabs and i3bar blocks are measured and drawn over and over
+ * with the same text, so the widths and the laid out text are kept in a cache
+ * of the most recently used entries. */
+#define TEXT_CACHE_SIZE 512
+
+struct text_cache_entry {
+    const i3Font *font;
+    bool pango_markup;
+    /* The maximum width of drawn text, or -1 for entries which only store the
+     * width of the text. */
+    int max_width;
+    char *text;
+    size_t text_len;
+
+    int width;
+    PangoLayout *layout;
+
+    /* The position in the LRU list, most recently used first. */
+    GList link;
+};
+
+static GHashTable *text_cache;
+static GQueue text_cache_lru = G_QUEUE_INIT;
+
 static PangoLayout *create_layout_with_dpi(cairo_t *cr) {
     PangoLayout *layout;
     PangoContext *context;
@@ -35,6 +67,107 @@ static PangoLayout *create_layout_with_dpi(cairo_t *cr) {
     return layout;
 }
 
+/* FNV-1a over the text, mixed with the rest of the key */
+static guint text_cache_hash(gconstpointer key) {
+    const struct text_cache_entry *entry = key;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < entry->text_len; i++) {
+        hash ^= (uint8_t)entry->text[i];
+        hash *= 16777619u;
+    }
+    hash ^= (uint32_t)(uintptr_t)entry->font;
+    hash = hash * 31 + (uint32_t)entry->max_width;
+    return hash * 2 + entry->pango_markup;
+}
+
+static gboolean text_cache_equal(gconstpointer a, gconstpointer b) {
+    const struct text_cache_entry *first = a;
+    const struct text_cache_entry *second = b;
+    return first->font == second->font &&
+           first->pango_markup == second->pango_markup &&
+           first->max_width == second->max_width &&
+           first->text_len == second->text_len &&
+           memcmp(first->text, second->text, first->text_len) == 0;
+}
+
+static void text_cache_entry_free(gpointer data) {
+    struct text_cache_entry *entry = data;
+    if (entry->layout != NULL) {
+        g_object_unref(entry->layout);
+    }
+    free(entry->text);
+    free(entry);
+}
+
+/*
+ * Removes all entries from the text cache. Called whenever a font is freed,
+ * because the cache is keyed by the address of the font.
+ *
+ */
+static void text_cache_clear(void) {
+    if (text_cache == NULL) {
+        return;
+    }
+    /* The links are part of the entries, which are freed by the table. */
+    g_queue_init(&text_cache_lru);
+    g_hash_table_remove_all(text_cache);
+}
+
+/*
+ * Returns the cache entry for the given text in the current font, or NULL if
+ * there is none. The entry becomes the most recently used one.
+ *
+ */
+static struct text_cache_entry *text_cache_lookup(const char *text, size_t text_len, int max_width, bool pango_markup) {
+    if (text_cache == NULL) {
+        return NULL;
+    }
+
+    struct text_cache_entry key = {
+        .font = savedFont,
+        .pango_markup = pango_markup,
+        .max_width = max_width,
+        .text = (char *)text,
+        .text_len = text_len};
+    struct text_cache_entry *entry = g_hash_table_lookup(text_cache, &key);
+    if (entry != NULL) {
+        g_queue_unlink(&text_cache_lru, &(entry->link));
+        g_queue_push_head_link(&text_cache_lru, &(entry->link));
+    }
+    return entry;
+}
+
+/*
+ * Adds a new entry for the given text in the current font to the cache,
+ * evicting the least recently used entry if the cache is full. The caller
+ * fills in the width or layout.
+ *
+ */
+static struct text_cache_entry *text_cache_insert(const char *text, size_t text_len, int max_width, bool pango_markup) {
+    if (text_cache == NULL) {
+        text_cache = g_hash_table_new_full(text_cache_hash, text_cache_equal, NULL, text_cache_entry_free);
+    }
+
+    if (g_queue_get_length(&text_cache_lru) >= TEXT_CACHE_SIZE) {
+        GList *oldest = g_queue_pop_tail_link(&text_cache_lru);
+        g_hash_table_remove(text_cache, oldest->data);
+    }
+
+    struct text_cache_entry *entry = scalloc(1, sizeof(struct text_cache_entry));
+    entry->font = savedFont;
+    entry->pango_markup = pango_markup;
+    entry->max_width = max_width;
+    entry->text = smalloc(text_len + 1);
+    memcpy(entry->text, text, text_len);
+    entry->text[text_len] = '\0';
+    entry->text_len = text_len;
+    entry->link.data = entry;
+
+    g_hash_table_insert(text_cache, entry, entry);
+    g_queue_push_head_link(&text_cache_lru, &(entry->link));
+    return entry;
+}
+
 /*
  * Loads a Pango font description into an i3Font structure. Returns true
  * on success, false otherwise.
@@ -57,22 +190,22 @@ static bool load_pango_font(i3Font *font, const char *desc) {
      * that would need root_visual_type */
     root_visual_type = get_visualtype(root_screen);
 
-    /* Create a dummy Pango layout to compute the font height */
-    cairo_surface_t *surface = cairo_xcb_surface_create(conn, root_screen->root, root_visual_type, 1, 1);
-    cairo_t *cr = cairo_create(surface);
-    PangoLayout *layout = create_layout_with_dpi(cr);
-    pango_layout_set_font_description(layout, font->specific.pango_desc);
+    /* Create the context for measuring text, which is also used to compute
+     * the font height */
+    if (measure_layout == NULL) {
+        measure_surface = cairo_xcb_surface_create(conn, root_screen->root, root_visual_type, 1, 1);
+        measure_cr = cairo_create(measure_surface);
+        measure_layout = create_layout_with_dpi(measure_cr);
+    }
 
     /* Get the font height */
     gint height;
-    pango_layout_get_pixel_size(layout, NULL, &height);
+    pango_layout_set_font_description(measure_layout, font->specific.pango_desc);
+    pango_layout_set_attributes(measure_layout, NULL);
+    pango_layout_set_text(measure_layout, "", 0);
+    pango_layout_get_pixel_size(measure_layout, NULL, &height);
     font->height = height;
 
-    /* Free resources */
-    g_object_unref(layout);
-    cairo_destroy(cr);
-    cairo_surface_destroy(surface);
-
     /* Set the font type and return successfully */
     font->type = FONT_TYPE_PANGO;
     return true;
@@ -85,21 +218,29 @@ static bool load_pango_font(i3Font *font, const char *desc) {
 static void draw_text_pango(const char *text, size_t text_len,
                             xcb_drawable_t drawable, cairo_surface_t *surface,
                             int x, int y, int max_width, bool pango_markup) {
-    /* Create the Pango layout */
-    /* root_visual_type is cached in load_pango_font */
     cairo_t *cr = cairo_create(surface);
-    PangoLayout *layout = create_layout_with_dpi(cr);
     gint height;
 
-    pango_layout_set_font_description(layout, savedFont->specific.pango_desc);
-    pango_layout_set_width(layout, max_width * PANGO_SCALE);
-    pango_layout_set_wrap(layout, PANGO_WRAP_CHAR);
-    pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
+    /* Create the Pango layout, unless this text was laid out before. The
+     * layout is owned by the cache. */
+    struct text_cache_entry *entry = text_cache_lookup(text, text_len, max_width, pango_markup);
+    if (entry == NULL) {
+        entry = text_cache_insert(text, text_len, max_width, pango_markup);
 
-    if (pango_markup)
-        pango_layout_set_markup(layout, text, text_len);
-    else
-        pango_layout_set_text(layout, text, text_len);
+        PangoLayout *layout = create_layout_with_dpi(measure_cr);
+        pango_layout_set_font_description(layout, savedFont->specific.pango_desc);
+        pango_layout_set_width(layout, max_width * PANGO_SCALE);
+        pango_layout_set_wrap(layout, PANGO_WRAP_CHAR);
+        pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
+
+        if (pango_markup)
+            pango_layout_set_markup(layout, text, text_len);
+        else
+            pango_layout_set_text(layout, text, text_len);
+
+        entry->layout = layout;
+    }
+    PangoLayout *layout = entry->layout;
 
     /* Do the drawing */
     cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
@@ -112,7 +253,6 @@ static void draw_text_pango(const char *text, size_t text_len,
     pango_cairo_show_layout(cr, layout);
 
     /* Free resources */
-    g_object_unref(layout);
     cairo_destroy(cr);
 }
 
@@ -121,29 +261,28 @@ static void draw_text_pango(const char *text, size_t text_len,
  *
  */
 static int predict_text_width_pango(const char *text, size_t text_len, bool pango_markup) {
-    /* Create a dummy Pango layout */
-    /* root_visual_type is cached in load_pango_font */
-    cairo_surface_t *surface = cairo_xcb_surface_create(conn, root_screen->root, root_visual_type, 1, 1);
-    cairo_t *cr = cairo_create(surface);
-    PangoLayout *layout = create_layout_with_dpi(cr);
+    struct text_cache_entry *entry = text_cache_lookup(text, text_len, -1, pango_markup);
+    if (entry != NULL) {
+        return entry->width;
+    }
 
     /* Get the font width */
+    /* measure_layout is created in load_pango_font */
     gint width;
-    pango_layout_set_font_description(layout, savedFont->specific.pango_desc);
+    pango_layout_set_font_description(measure_layout, savedFont->specific.pango_desc);
 
+    /* Drop the attributes parsed from the markup of a previous measurement */
+    pango_layout_set_attributes(measure_layout, NULL);
     if (pango_markup)
-        pango_layout_set_markup(layout, text, text_len);
+        pango_layout_set_markup(measure_layout, text, text_len);
     else
-        pango_layout_set_text(layout, text, text_len);
-
-    pango_cairo_update_layout(cr, layout);
-    pango_layout_get_pixel_size(layout, &width, NULL);
+        pango_layout_set_text(measure_layout, text, text_len);
 
-    /* Free resources */
-    g_object_unref(layout);
-    cairo_destroy(cr);
-    cairo_surface_destroy(surface);
+    pango_cairo_update_layout(measure_cr, measure_layout);
+    pango_layout_get_pixel_size(measure_layout, &width, NULL);
 
+    entry = text_cache_insert(text, text_len, -1, pango_markup);
+    entry->width = width;
     return width;
 }
 
@@ -235,6 +374,9 @@ i3Font load_font(const char *pattern, const bool fallback) {
     else
         font.specific.xcb.table = xcb_query_font_char_infos(font.specific.xcb.info);
 
+    /* The character widths are only computed when text is measured */
+    font.specific.xcb.widths = NULL;
+
     /* Calculate the font height */
     font.height = font.specific.xcb.info->font_ascent + font.specific.xcb.info->font_descent;
 
@@ -270,10 +412,13 @@ void free_font(void) {
             /* Close the font and free the info */
             xcb_close_font(conn, savedFont->specific.xcb.id);
             free(savedFont->specific.xcb.info);
+            free(savedFont->specific.xcb.widths);
             break;
         }
         case FONT_TYPE_PANGO:
-            /* Free the font description */
+            /* Forget the text laid out in this font and free the font
+             * description */
+            text_cache_clear();
             pango_font_description_free(savedFont->specific.pango_desc);
             break;
     }
@@ -376,74 +521,133 @@ void draw_text(i3String *text, xcb_drawable_t drawable, xcb_gcontext_t gc,
     }
 }
 
-static int xcb_query_text_width(const xcb_char2b_t *text, size_t text_len) {
-    /* Make the user know we’re using the slow path, but only once. */
-    static bool first_invocation = true;
-    if (first_invocation) {
-        fprintf(stderr, "Using slow code path for text extents\n");
-        first_invocation = false;
+/* Marks characters of the width table which were not queried yet. */
+#define GLYPH_WIDTH_UNKNOWN INT16_MIN
+
+/* Marks characters of the width table which are being queried. */
+#define GLYPH_WIDTH_PENDING (INT16_MIN + 1)
+
+#define GLYPH_INDEX(c) (((c).byte1 << 8) | (c).byte2)
+
+/*
+ * Returns the width table of the current font, creating it if necessary. If
+ * the font has a font table, every width is computed right away. Otherwise,
+ * all widths start out unknown and are queried by query_glyph_widths().
+ *
+ */
+static int16_t *get_glyph_widths(void) {
+    if (savedFont->specific.xcb.widths != NULL)
+        return savedFont->specific.xcb.widths;
+
+    int16_t *widths = smalloc(65536 * sizeof(int16_t));
+    savedFont->specific.xcb.widths = widths;
+
+    if (savedFont->specific.xcb.table == NULL) {
+        for (size_t i = 0; i < 65536; i++)
+            widths[i] = GLYPH_WIDTH_UNKNOWN;
+        return widths;
     }
 
-    /* Query the text width */
-    xcb_generic_error_t *error;
-    xcb_query_text_extents_cookie_t cookie = xcb_query_text_extents(conn,
-                                                                    savedFont->specific.xcb.id, text_len, (xcb_char2b_t *)text);
-    xcb_query_text_extents_reply_t *reply = xcb_query_text_extents_reply(conn,
-                                                                         cookie, &error);
-    if (reply == NULL) {
-        /* We return a safe estimate because a rendering error is better than
-         * a crash. Plus, the user will see the error in their log. */
-        fprintf(stderr, "Could not get text extents (X error code %d)\n",
-                error->error_code);
-        free(error);
-        return savedFont->specific.xcb.info->max_bounds.character_width * text_len;
+    /* Save some pointers for convenience */
+    xcb_query_font_reply_t *font_info = savedFont->specific.xcb.info;
+    xcb_charinfo_t *font_table = savedFont->specific.xcb.table;
+
+    for (int row = 0; row < 256; row++) {
+        for (int col = 0; col < 256; col++) {
+            int16_t width = 0;
+            if (row >= font_info->min_byte1 &&
+                row <= font_info->max_byte1 &&
+                col >= font_info->min_char_or_byte2 &&
+                col <= font_info->max_char_or_byte2) {
+                /* Don't you ask me, how this one works… (Merovius) */
+                xcb_charinfo_t *info = &font_table[((row - font_info->min_byte1) *
+                                                    (font_info->max_char_or_byte2 - font_info->min_char_or_byte2 + 1)) +
+                                                   (col - font_info->min_char_or_byte2)];
+
+                if (info->character_width != 0 ||
+                    (info->right_side_bearing |
+                     info->left_side_bearing |
+                     info->ascent |
+                     info->descent) != 0) {
+                    width = info->character_width;
+                }
+            }
+            widths[(row << 8) | col] = width;
+        }
     }
 
-    int width = reply->overall_width;
-    free(reply);
-    return width;
+    return widths;
+}
+
+/*
+ * Queries the widths of all characters of the given text which are not in the
+ * width table yet. All queries are sent before the first reply is read, so
+ * this takes at most one round trip, and none once every character of the
+ * text has been seen.
+ *
+ */
+static void query_glyph_widths(int16_t *widths, const xcb_char2b_t *text, size_t text_len) {
+    xcb_char2b_t *chars = NULL;
+    xcb_query_text_extents_cookie_t *cookies = NULL;
+    size_t num_queries = 0;
+
+    for (size_t i = 0; i < text_len; i++) {
+        if (widths[GLYPH_INDEX(text[i])] != GLYPH_WIDTH_UNKNOWN)
+            continue;
+
+        if (chars == NULL) {
+            /* Make the user know we’re using the slow path, but only once. */
+            static bool first_invocation = true;
+            if (first_invocation) {
+                fprintf(stderr, "Using slow code path for text extents\n");
+                first_invocation = false;
+            }
+
+            chars = smalloc(text_len * sizeof(xcb_char2b_t));
+            cookies = smalloc(text_len * sizeof(xcb_query_text_extents_cookie_t));
+        }
+
+        widths[GLYPH_INDEX(text[i])] = GLYPH_WIDTH_PENDING;
+        chars[num_queries] = text[i];
+        cookies[num_queries] = xcb_query_text_extents(conn, savedFont->specific.xcb.id, 1, &(chars[num_queries]));
+        num_queries++;
+    }
+
+    for (size_t i = 0; i < num_queries; i++) {
+        xcb_generic_error_t *error;
+        xcb_query_text_extents_reply_t *reply = xcb_query_text_extents_reply(conn, cookies[i], &error);
+        if (reply == NULL) {
+            /* We use a safe estimate because a rendering error is better than
+             * a crash. Plus, the user will see the error in their log. */
+            fprintf(stderr, "Could not get text extents (X error code %d)\n",
+                    error->error_code);
+            free(error);
+            widths[GLYPH_INDEX(chars[i])] = savedFont->specific.xcb.info->max_bounds.character_width;
+            continue;
+        }
+
+        widths[GLYPH_INDEX(chars[i])] = reply->overall_width;
+        free(reply);
+    }
+
+    free(chars);
+    free(cookies);
 }
 
 static int predict_text_width_xcb(const xcb_char2b_t *input, size_t text_len) {
     if (text_len == 0)
         return 0;
 
-    int width;
-    if (savedFont->specific.xcb.table == NULL) {
-        /* If we don't have a font table, fall back to querying the server */
-        width = xcb_query_text_width(input, text_len);
-    } else {
-        /* Save some pointers for convenience */
-        xcb_query_font_reply_t *font_info = savedFont->specific.xcb.info;
-        xcb_charinfo_t *font_table = savedFont->specific.xcb.table;
-
-        /* Calculate the width using the font table */
-        width = 0;
-        for (size_t i = 0; i < text_len; i++) {
-            xcb_charinfo_t *info;
-            int row = input[i].byte1;
-            int col = input[i].byte2;
-
-            if (row < font_info->min_byte1 ||
-                row > font_info->max_byte1 ||
-                col < font_info->min_char_or_byte2 ||
-                col > font_info->max_char_or_byte2)
-                continue;
-
-            /* Don't you ask me, how this one works… (Merovius) */
-            info = &font_table[((row - font_info->min_byte1) *
-                                (font_info->max_char_or_byte2 - font_info->min_char_or_byte2 + 1)) +
-                               (col - font_info->min_char_or_byte2)];
-
-            if (info->character_width != 0 ||
-                (info->right_side_bearing |
-                 info->left_side_bearing |
-                 info->ascent |
-                 info->descent) != 0) {
-                width += info->character_width;
-            }
-        }
-    }
+    int16_t *widths = get_glyph_widths();
+
+    /* If we don't have a font table, ask the server for the characters we
+     * did not see before */
+    if (savedFont->specific.xcb.table == NULL)
+        query_glyph_widths(widths, input, text_len);
+
+    int width = 0;
+    for (size_t i = 0; i < text_len; i++)
+        width += widths[GLYPH_INDEX(input[i])];
 
     return width;
 }
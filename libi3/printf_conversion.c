@@ -0,0 +1,134 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ */
+#include "libi3.h"
+
+#include <string.h>
+
+/*
+ * Finds the next conversion specification (e.g. "%-5.*s") in the given printf
+ * format string and describes it in *conv. Returns a pointer to its '%', or
+ * NULL if there are no more conversions. Conversions which cannot be passed
+ * through a binary log (e.g. %n, %m or long double) have the type
+ * PRINTF_ARG_UNSUPPORTED.
+ *
+ */
+const char *next_printf_conversion(const char *fmt, printf_conversion_t *conv) {
+    const char *start = strchr(fmt, '%');
+    if (start == NULL) {
+        return NULL;
+    }
+
+    const char *walk = start + 1;
+    conv->stars = 0;
+    conv->precision = -1;
+
+    /* flags */
+    while (*walk != '\0' && strchr("-+ #0'", *walk) != NULL) {
+        walk++;
+    }
+    /* field width */
+    if (*walk == '*') {
+        conv->stars++;
+        walk++;
+    } else {
+        while (*walk >= '0' && *walk <= '9') {
+            walk++;
+        }
+    }
+    /* precision */
+    if (*walk == '.') {
+        walk++;
+        if (*walk == '*') {
+            conv->stars++;
+            conv->precision = -2;
+            walk++;
+        } else {
+            conv->precision = 0;
+            while (*walk >= '0' && *walk <= '9') {
+                conv->precision = conv->precision * 10 + (*walk - '0');
+                walk++;
+            }
+        }
+    }
+
+    /* length modifier */
+    conv->modifier_offset = (walk - start);
+    conv->length_modifier = PRINTF_LENGTH_NONE;
+    switch (*walk) {
+        case 'h':
+            conv->length_modifier = (walk[1] == 'h' ? PRINTF_LENGTH_HH : PRINTF_LENGTH_H);
+            break;
+        case 'l':
+            conv->length_modifier = (walk[1] == 'l' ? PRINTF_LENGTH_LL : PRINTF_LENGTH_L);
+            break;
+        case 'z':
+            conv->length_modifier = PRINTF_LENGTH_Z;
+            break;
+        case 'j':
+            conv->length_modifier = PRINTF_LENGTH_J;
+            break;
+        case 't':
+            conv->length_modifier = PRINTF_LENGTH_T;
+            break;
+        case 'L':
+            conv->length_modifier = PRINTF_LENGTH_LONG_DOUBLE;
+            break;
+    }
+    if (conv->length_modifier == PRINTF_LENGTH_HH || conv->length_modifier == PRINTF_LENGTH_LL) {
+        walk += 2;
+    } else if (conv->length_modifier != PRINTF_LENGTH_NONE) {
+        walk++;
+    }
+
+    conv->conversion = *walk;
+    switch (*walk) {
+        case '%':
+            conv->type = PRINTF_ARG_NONE;
+            break;
+        case 'd':
+        case 'i':
+            conv->type = PRINTF_ARG_SIGNED;
+            break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            conv->type = PRINTF_ARG_UNSIGNED;
+            break;
+        case 'c':
+            conv->type = (conv->length_modifier == PRINTF_LENGTH_NONE ? PRINTF_ARG_CHAR : PRINTF_ARG_UNSUPPORTED);
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            conv->type = (conv->length_modifier == PRINTF_LENGTH_NONE || conv->length_modifier == PRINTF_LENGTH_L
+                              ? PRINTF_ARG_DOUBLE
+                              : PRINTF_ARG_UNSUPPORTED);
+            break;
+        case 's':
+            conv->type = (conv->length_modifier == PRINTF_LENGTH_NONE ? PRINTF_ARG_STRING : PRINTF_ARG_UNSUPPORTED);
+            break;
+        case 'p':
+            conv->type = PRINTF_ARG_POINTER;
+            break;
+        default:
+            conv->type = PRINTF_ARG_UNSUPPORTED;
+            break;
+    }
+    if (*walk != '\0') {
+        walk++;
+    }
+
+    conv->length = (walk - start);
+    return start;
+}
@@ -9,6 +9,189 @@
  */
 #include "all.h"
 
+/*
+ * Assignments are indexed by their class criterion (or, if the class is not
+ * specified as an exact literal, by their instance criterion) when that
+ * criterion is an exact literal like ^Firefox$. For a window, only the
+ * assignments in the buckets for its class and instance and the assignments
+ * which could not be indexed need to be checked.
+ *
+ */
+struct assignment_bucket {
+    char *literal;
+    Assignment **rules;
+    int num_rules;
+
+    /* Buckets whose literals have the same hash. */
+    struct assignment_bucket *next;
+};
+
+static struct hashmap class_index;
+static struct hashmap instance_index;
+static Assignment **unindexed_rules = NULL;
+static int num_unindexed_rules = 0;
+static int num_rules = 0;
+
+/* FNV-1a over the first len bytes of str. */
+static uint64_t literal_hash(const char *str, size_t len) {
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)str[i];
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+/*
+ * Returns the literal which the given regular expression matches exactly
+ * (without the anchors) or NULL if it is not of the form ^literal$.
+ *
+ */
+static char *exact_literal(struct regex *regex) {
+    if (regex == NULL)
+        return NULL;
+
+    const char *pattern = regex->pattern;
+    const size_t len = strlen(pattern);
+    if (len < 2 || pattern[0] != '^' || pattern[len - 1] != '$')
+        return NULL;
+
+    /* PCRE’s $ also matches before a trailing newline, which we handle when
+     * looking up a window (see find_bucket()), so a literal must not contain
+     * a newline itself. */
+    for (size_t i = 1; i < len - 1; i++) {
+        if (strchr("\\^$.|?*+()[]{}\n", pattern[i]) != NULL)
+            return NULL;
+    }
+
+    return sstrndup(pattern + 1, len - 2);
+}
+
+static void add_to_bucket(struct hashmap *index, char *literal, Assignment *assignment) {
+    const uint64_t hash = literal_hash(literal, strlen(literal));
+    struct assignment_bucket *head = hashmap_get(index, hash);
+    struct assignment_bucket *bucket = head;
+    while (bucket != NULL && strcmp(bucket->literal, literal) != 0)
+        bucket = bucket->next;
+
+    if (bucket == NULL) {
+        bucket = scalloc(1, sizeof(struct assignment_bucket));
+        bucket->literal = literal;
+        bucket->next = head;
+        hashmap_put(index, hash, bucket);
+    } else {
+        free(literal);
+    }
+
+    bucket->rules = srealloc(bucket->rules, (bucket->num_rules + 1) * sizeof(Assignment *));
+    bucket->rules[bucket->num_rules++] = assignment;
+}
+
+static void free_index(struct hashmap *index) {
+    for (size_t i = 0; i < index->capacity; i++) {
+        struct assignment_bucket *bucket = index->entries[i].value;
+        while (bucket != NULL) {
+            struct assignment_bucket *next = bucket->next;
+            free(bucket->literal);
+            free(bucket->rules);
+            free(bucket);
+            bucket = next;
+        }
+    }
+    hashmap_free(index);
+}
+
+/*
+ * Returns the bucket for the given window property, or NULL. Like
+ * match_matches_window(), a missing property is treated as the empty string.
+ *
+ */
+static struct assignment_bucket *find_bucket(struct hashmap *index, const char *value) {
+    if (value == NULL)
+        value = "";
+    size_t len = strlen(value);
+    /* ^literal$ also matches "literal\n". */
+    if (len > 0 && value[len - 1] == '\n')
+        len--;
+
+    struct assignment_bucket *bucket = hashmap_get(index, literal_hash(value, len));
+    while (bucket != NULL &&
+           (strlen(bucket->literal) != len || strncmp(bucket->literal, value, len) != 0))
+        bucket = bucket->next;
+    return bucket;
+}
+
+/*
+ * (Re-)builds the index of all assignments. Needs to be called whenever the
+ * list of assignments changed, i.e. after (re-)loading the configuration.
+ *
+ */
+void reindex_assignments(void) {
+    free_index(&class_index);
+    free_index(&instance_index);
+    FREE(unindexed_rules);
+    num_unindexed_rules = 0;
+    num_rules = 0;
+
+    Assignment *assignment;
+    TAILQ_FOREACH (assignment, &assignments, assignments) {
+        assignment->position = num_rules++;
+
+        char *literal;
+        if ((literal = exact_literal(assignment->match.class)) != NULL) {
+            add_to_bucket(&class_index, literal, assignment);
+        } else if ((literal = exact_literal(assignment->match.instance)) != NULL) {
+            add_to_bucket(&instance_index, literal, assignment);
+        } else {
+            unindexed_rules = srealloc(unindexed_rules, (num_unindexed_rules + 1) * sizeof(Assignment *));
+            unindexed_rules[num_unindexed_rules++] = assignment;
+        }
+    }
+
+    DLOG("Indexed %d assignments, %d need to be checked for every window\n",
+         num_rules, num_unindexed_rules);
+}
+
+/*
+ * The assignments which can match a window, in configuration order: the
+ * contents of its class and instance buckets and the unindexed assignments.
+ *
+ */
+struct candidates {
+    Assignment **lists[3];
+    int lengths[3];
+    int positions[3];
+};
+
+static void candidates_init(struct candidates *candidates, i3Window *window) {
+    struct assignment_bucket *by_class = find_bucket(&class_index, window->class_class);
+    struct assignment_bucket *by_instance = find_bucket(&instance_index, window->class_instance);
+
+    candidates->lists[0] = (by_class ? by_class->rules : NULL);
+    candidates->lengths[0] = (by_class ? by_class->num_rules : 0);
+    candidates->lists[1] = (by_instance ? by_instance->rules : NULL);
+    candidates->lengths[1] = (by_instance ? by_instance->num_rules : 0);
+    candidates->lists[2] = unindexed_rules;
+    candidates->lengths[2] = num_unindexed_rules;
+    for (int i = 0; i < 3; i++)
+        candidates->positions[i] = 0;
+}
+
+static Assignment *candidates_next(struct candidates *candidates) {
+    int next = -1;
+    for (int i = 0; i < 3; i++) {
+        if (candidates->positions[i] == candidates->lengths[i])
+            continue;
+        if (next == -1 ||
+            candidates->lists[i][candidates->positions[i]]->position <
+                candidates->lists[next][candidates->positions[next]]->position)
+            next = i;
+    }
+    if (next == -1)
+        return NULL;
+    return candidates->lists[next][candidates->positions[next]++];
+}
+
 /*
  * Checks the list of assignments for the given window and runs all matching
  * ones (unless they have already been run for this specific window).
@@ -18,11 +201,17 @@ void run_assignments(i3Window *window) {
     DLOG("Checking if any assignments match this window\n");
 
     bool needs_tree_render = false;
+    int evaluated = 0;
 
     /* Check if any assignments match */
+    struct candidates candidates;
+    candidates_init(&candidates, window);
     Assignment *current;
-    TAILQ_FOREACH (current, &assignments, assignments) {
-        if (current->type != A_COMMAND || !match_matches_window(&(current->match), window))
+    while ((current = candidates_next(&candidates)) != NULL) {
+        if (current->type != A_COMMAND)
+            continue;
+        evaluated++;
+        if (!match_matches_window(&(current->match), window))
             continue;
 
         bool skip = false;
@@ -57,6 +246,8 @@ void run_assignments(i3Window *window) {
         command_result_free(result);
     }
 
+    DLOG("Evaluated %d of %d assignments\n", evaluated, num_rules);
+
     /* If any of the commands required re-rendering, we will do that now. */
     if (needs_tree_render)
         tree_render();
@@ -67,15 +258,21 @@ void run_assignments(i3Window *window) {
  *
  */
 Assignment *assignment_for(i3Window *window, int type) {
-    Assignment *assignment;
+    int evaluated = 0;
 
-    TAILQ_FOREACH (assignment, &assignments, assignments) {
-        if ((type != A_ANY && (assignment->type & type) == 0) ||
-            !match_matches_window(&(assignment->match), window))
+    struct candidates candidates;
+    candidates_init(&candidates, window);
+    Assignment *assignment;
+    while ((assignment = candidates_next(&candidates)) != NULL) {
+        if (type != A_ANY && (assignment->type & type) == 0)
+            continue;
+        evaluated++;
+        if (!match_matches_window(&(assignment->match), window))
             continue;
-        DLOG("got a matching assignment\n");
+        DLOG("got a matching assignment (evaluated %d of %d assignments)\n", evaluated, num_rules);
         return assignment;
     }
 
+    DLOG("Evaluated %d of %d assignments\n", evaluated, num_rules);
     return NULL;
 }
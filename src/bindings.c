@@ -6,6 +6,7 @@
  *
  * bindings.c: Functions for configuring, finding and, running bindings.
  */
+#define I3_LOG_CATEGORY LOG_CATEGORY_BINDINGS
 #include "all.h"
 
 #include <math.h>
@@ -193,6 +194,94 @@ void regrab_all_buttons(xcb_connection_t *conn) {
     xcb_ungrab_server(conn);
 }
 
+/* The bindings of the current mode which could match a given input code, in
+ * the order of the bindings list. */
+struct binding_candidates {
+    Binding **bindings;
+    size_t count;
+    size_t capacity;
+};
+
+/* Dispatch table for get_binding(), mapping (input type, keycode or button)
+ * to the bindings which use it. It is built lazily for the current bindings
+ * list and thrown away whenever keycodes are translated again or the
+ * bindings are reordered. */
+static struct hashmap binding_dispatch;
+static struct bindings_head *binding_dispatch_for = NULL;
+
+/* The release bindings of the current mode, which are the only ones that can
+ * be marked B_UPON_KEYRELEASE_IGNORE_MODS. */
+static struct binding_candidates binding_dispatch_release;
+
+static uint64_t binding_dispatch_key(input_type_t input_type, uint16_t input_code) {
+    return ((uint64_t)input_type << 16) | input_code;
+}
+
+static void binding_candidates_add(struct binding_candidates *candidates, Binding *bind) {
+    /* Each binding is added once per code, even if several of its keycodes
+     * (with different modifiers) use the same code. */
+    if (candidates->count > 0 && candidates->bindings[candidates->count - 1] == bind) {
+        return;
+    }
+    if (candidates->count == candidates->capacity) {
+        candidates->capacity = (candidates->capacity == 0 ? 4 : candidates->capacity * 2);
+        candidates->bindings = srealloc(candidates->bindings, candidates->capacity * sizeof(Binding *));
+    }
+    candidates->bindings[candidates->count++] = bind;
+}
+
+static void binding_dispatch_add(input_type_t input_type, uint16_t input_code, Binding *bind) {
+    const uint64_t key = binding_dispatch_key(input_type, input_code);
+    struct binding_candidates *candidates = hashmap_get(&binding_dispatch, key);
+    if (candidates == NULL) {
+        candidates = scalloc(1, sizeof(struct binding_candidates));
+        hashmap_put(&binding_dispatch, key, candidates);
+    }
+    binding_candidates_add(candidates, bind);
+}
+
+/*
+ * Frees the dispatch table. It will be rebuilt on the next call of
+ * get_binding().
+ *
+ */
+static void binding_dispatch_invalidate(void) {
+    for (size_t i = 0; i < binding_dispatch.capacity; i++) {
+        struct binding_candidates *candidates = binding_dispatch.entries[i].value;
+        if (candidates != NULL) {
+            free(candidates->bindings);
+            free(candidates);
+        }
+    }
+    hashmap_free(&binding_dispatch);
+    FREE(binding_dispatch_release.bindings);
+    binding_dispatch_release.count = 0;
+    binding_dispatch_release.capacity = 0;
+    binding_dispatch_for = NULL;
+}
+
+static void binding_dispatch_build(void) {
+    binding_dispatch_invalidate();
+
+    Binding *bind;
+    TAILQ_FOREACH (bind, bindings, bindings) {
+        if (bind->release != B_UPON_KEYPRESS) {
+            binding_candidates_add(&binding_dispatch_release, bind);
+        }
+
+        if (bind->input_type == B_KEYBOARD && bind->symbol != NULL) {
+            struct Binding_Keycode *binding_keycode;
+            TAILQ_FOREACH (binding_keycode, &(bind->keycodes_head), keycodes) {
+                binding_dispatch_add(B_KEYBOARD, binding_keycode->keycode, bind);
+            }
+        } else {
+            binding_dispatch_add(bind->input_type, bind->keycode, bind);
+        }
+    }
+
+    binding_dispatch_for = bindings;
+}
+
 /*
  * Returns a pointer to the Binding with the specified modifiers and
  * keycode or NULL if no such binding exists.
@@ -202,10 +291,15 @@ static Binding *get_binding(i3_event_state_mask_t state_filtered, bool is_releas
     Binding *bind;
     Binding *result = NULL;
 
+    if (binding_dispatch_for != bindings) {
+        binding_dispatch_build();
+    }
+
     if (!is_release) {
         /* On a press event, we first reset all B_UPON_KEYRELEASE_IGNORE_MODS
          * bindings back to B_UPON_KEYRELEASE */
-        TAILQ_FOREACH (bind, bindings, bindings) {
+        for (size_t i = 0; i < binding_dispatch_release.count; i++) {
+            bind = binding_dispatch_release.bindings[i];
             if (bind->input_type != input_type)
                 continue;
             if (bind->release == B_UPON_KEYRELEASE_IGNORE_MODS)
@@ -213,12 +307,16 @@ static Binding *get_binding(i3_event_state_mask_t state_filtered, bool is_releas
         }
     }
 
+    const struct binding_candidates *candidates =
+        hashmap_get(&binding_dispatch, binding_dispatch_key(input_type, input_code));
+    if (candidates == NULL) {
+        return NULL;
+    }
+
     const uint32_t xkb_group_state = (state_filtered & 0xFFFF0000);
     const uint32_t modifiers_state = (state_filtered & 0x0000FFFF);
-    TAILQ_FOREACH (bind, bindings, bindings) {
-        if (bind->input_type != input_type) {
-            continue;
-        }
+    for (size_t i = 0; i < candidates->count; i++) {
+        bind = candidates->bindings[i];
 
         const uint32_t xkb_group_mask = (bind->event_state_mask & 0xFFFF0000);
         const bool groups_match = ((xkb_group_state & xkb_group_mask) == xkb_group_mask);
@@ -237,8 +335,6 @@ static Binding *get_binding(i3_event_state_mask_t state_filtered, bool is_releas
             TAILQ_FOREACH (binding_keycode, &(bind->keycodes_head), keycodes) {
                 const uint32_t modifiers_mask = (binding_keycode->modifiers & 0x0000FFFF);
                 const bool mods_match = (modifiers_mask == modifiers_state);
-                DLOG("binding_keycode->modifiers = %d, modifiers_mask = %d, modifiers_state = %d, mods_match = %s\n",
-                     binding_keycode->modifiers, modifiers_mask, modifiers_state, (mods_match ? "yes" : "no"));
                 if (binding_keycode->keycode == input_keycode &&
                     (mods_match || (bind->release == B_UPON_KEYRELEASE_IGNORE_MODS && is_release))) {
                     found_keycode = true;
@@ -246,17 +342,12 @@ static Binding *get_binding(i3_event_state_mask_t state_filtered, bool is_releas
                 }
             }
         } else {
-            /* This case is easier: The user specified a keycode */
-            if (bind->keycode != input_code) {
-                continue;
-            }
-
+            /* This case is easier: The user specified a keycode (which the
+             * dispatch table already matched). */
             struct Binding_Keycode *binding_keycode;
             TAILQ_FOREACH (binding_keycode, &(bind->keycodes_head), keycodes) {
                 const uint32_t modifiers_mask = (binding_keycode->modifiers & 0x0000FFFF);
                 const bool mods_match = (modifiers_mask == modifiers_state);
-                DLOG("binding_keycode->modifiers = %d, modifiers_mask = %d, modifiers_state = %d, mods_match = %s\n",
-                     binding_keycode->modifiers, modifiers_mask, modifiers_state, (mods_match ? "yes" : "no"));
                 if (mods_match || (bind->release == B_UPON_KEYRELEASE_IGNORE_MODS && is_release)) {
                     found_keycode = true;
                     break;
@@ -601,6 +692,10 @@ void translate_keysyms(void) {
     }
 
 out:
+    /* The translated keycodes changed, so the dispatch table has to be
+     * rebuilt. */
+    binding_dispatch_invalidate();
+
     xkb_state_unref(dummy_state);
     xkb_state_unref(dummy_state_no_shift);
     xkb_state_unref(dummy_state_numlock);
@@ -644,7 +739,7 @@ void switch_mode(const char *new_mode) {
         sasprintf(&event_msg, "{\"change\":\"%s\", \"pango_markup\":%s}",
                   mode->name, (mode->pango_markup ? "true" : "false"));
 
-        ipc_send_event("mode", I3_IPC_EVENT_MODE, event_msg);
+        ipc_send_event(I3_IPC_EVENT_MODE, event_msg);
         FREE(event_msg);
 
         return;
@@ -715,6 +810,7 @@ void reorder_bindings(void) {
         if (current_mode)
             bindings = mode->bindings;
     }
+    binding_dispatch_invalidate();
 }
 
 /*
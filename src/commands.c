@@ -142,7 +142,6 @@ static owindows_head owindows;
  *
  */
 void cmd_criteria_init(I3_CMD) {
-    Con *con;
     owindow *ow;
 
     DLOG("Initializing criteria, current_match = %p\n", current_match);
@@ -154,94 +153,161 @@ void cmd_criteria_init(I3_CMD) {
         free(ow);
     }
     TAILQ_INIT(&owindows);
-    /* copy all_cons */
-    TAILQ_FOREACH (con, &all_cons, all_cons) {
-        ow = smalloc(sizeof(owindow));
-        ow->con = con;
-        TAILQ_INSERT_TAIL(&owindows, ow, owindows);
-    }
 }
 
 /*
- * A match specification just finished (the closing square bracket was found),
- * so we filter the list of owindows.
+ * Appends the given container to owindows if it matches the current match
+ * specification.
  *
  */
-void cmd_criteria_match_windows(I3_CMD) {
-    owindow *next, *current;
+static void criteria_match_con(Match *current_match, Con *con) {
+    DLOG("checking if con %p / %s matches\n", con, con->name);
 
-    DLOG("match specification finished, matching...\n");
-    /* copy the old list head to iterate through it and start with a fresh
-     * list which will contain only matching windows */
-    struct owindows_head old = owindows;
-    TAILQ_INIT(&owindows);
-    for (next = TAILQ_FIRST(&old); next != TAILQ_END(&old);) {
-        /* make a copy of the next pointer and advance the pointer to the
-         * next element as we are going to invalidate the element’s
-         * next/prev pointers by calling TAILQ_INSERT_TAIL later */
-        current = next;
-        next = TAILQ_NEXT(next, owindows);
+    /* We use this flag to prevent matching on window-less containers if
+     * only window-specific criteria were specified. */
+    bool accept_match = false;
 
-        DLOG("checking if con %p / %s matches\n", current->con, current->con->name);
+    if (current_match->con_id != NULL) {
+        accept_match = true;
 
-        /* We use this flag to prevent matching on window-less containers if
-         * only window-specific criteria were specified. */
-        bool accept_match = false;
+        if (current_match->con_id == con) {
+            DLOG("con_id matched.\n");
+        } else {
+            DLOG("con_id does not match.\n");
+            return;
+        }
+    }
 
-        if (current_match->con_id != NULL) {
-            accept_match = true;
+    if (current_match->mark != NULL && !TAILQ_EMPTY(&(con->marks_head))) {
+        accept_match = true;
+        bool matched_by_mark = false;
 
-            if (current_match->con_id == current->con) {
-                DLOG("con_id matched.\n");
-            } else {
-                DLOG("con_id does not match.\n");
-                FREE(current);
+        mark_t *mark;
+        TAILQ_FOREACH (mark, &(con->marks_head), marks) {
+            if (!regex_matches(current_match->mark, mark->name))
                 continue;
-            }
+
+            DLOG("match by mark\n");
+            matched_by_mark = true;
+            break;
         }
 
-        if (current_match->mark != NULL && !TAILQ_EMPTY(&(current->con->marks_head))) {
+        if (!matched_by_mark) {
+            DLOG("mark does not match.\n");
+            return;
+        }
+    }
+
+    if (con->window != NULL) {
+        if (match_matches_window(current_match, con->window)) {
+            DLOG("matches window!\n");
             accept_match = true;
-            bool matched_by_mark = false;
+        } else {
+            DLOG("doesn't match\n");
+            return;
+        }
+    }
 
-            mark_t *mark;
-            TAILQ_FOREACH (mark, &(current->con->marks_head), marks) {
-                if (!regex_matches(current_match->mark, mark->name))
-                    continue;
+    if (accept_match) {
+        owindow *ow = smalloc(sizeof(owindow));
+        ow->con = con;
+        TAILQ_INSERT_TAIL(&owindows, ow, owindows);
+    }
+}
 
-                DLOG("match by mark\n");
-                matched_by_mark = true;
-                break;
-            }
+/*
+ * Returns whether the name of the given workspace matches the workspace
+ * criterion, like match_matches_window() checks it.
+ *
+ */
+static bool criteria_match_workspace(Match *current_match, Con *ws) {
+    if (strcmp(current_match->workspace->pattern, "__focused__") == 0 &&
+        strcmp(ws->name, con_get_workspace(focused)->name) == 0) {
+        return true;
+    }
+    return regex_matches(current_match->workspace, ws->name);
+}
 
-            if (!matched_by_mark) {
-                DLOG("mark does not match.\n");
-                FREE(current);
-                continue;
+/*
+ * A match specification just finished (the closing square bracket was found),
+ * so we fill the list of owindows with all matching containers.
+ *
+ * Instead of checking every container, selective criteria are used to find
+ * the candidates: con_id and id directly identify (at most) one container,
+ * con_mark can only match containers with marks and workspace can only match
+ * (windows in) the workspaces whose names match. Candidates are checked in
+ * the order of all_cons, like every container used to be.
+ *
+ */
+void cmd_criteria_match_windows(I3_CMD) {
+    owindow *current;
+
+    DLOG("match specification finished, matching...\n");
+
+    if (current_match->con_id != NULL) {
+        /* con_id does not need to be a valid container. */
+        Con *con = con_by_con_id((long)current_match->con_id);
+        if (con != NULL) {
+            criteria_match_con(current_match, con);
+        }
+    } else if (current_match->id != XCB_NONE && current_match->mark == NULL) {
+        /* Without con_id or con_mark, only containers with windows can match,
+         * so the window ID identifies the container. */
+        Con *con = con_by_window_id(current_match->id);
+        if (con != NULL) {
+            criteria_match_con(current_match, con);
+        }
+    } else {
+        /* Without con_mark, only containers with windows can match, so the
+         * workspace criterion can be evaluated per workspace. */
+        Con **workspaces = NULL;
+        int num_workspaces = -1;
+        if (current_match->workspace != NULL && current_match->mark == NULL) {
+            num_workspaces = 0;
+            Con *output;
+            TAILQ_FOREACH (output, &(croot->nodes_head), nodes) {
+                Con *ws;
+                Con *content = output_get_content(output);
+                if (content == NULL) {
+                    continue;
+                }
+                TAILQ_FOREACH (ws, &(content->nodes_head), nodes) {
+                    if (criteria_match_workspace(current_match, ws)) {
+                        workspaces = srealloc(workspaces, (num_workspaces + 1) * sizeof(Con *));
+                        workspaces[num_workspaces++] = ws;
+                    }
+                }
             }
         }
 
-        if (current->con->window != NULL) {
-            if (match_matches_window(current_match, current->con->window)) {
-                DLOG("matches window!\n");
-                accept_match = true;
-            } else {
-                DLOG("doesn't match\n");
-                FREE(current);
+        Con *con;
+        TAILQ_FOREACH (con, &all_cons, all_cons) {
+            if (current_match->mark != NULL && TAILQ_EMPTY(&(con->marks_head))) {
                 continue;
             }
+            if (num_workspaces != -1) {
+                if (con->window == NULL) {
+                    continue;
+                }
+                Con *ws = con_get_workspace(con);
+                bool found = false;
+                for (int i = 0; i < num_workspaces && !found; i++) {
+                    found = (workspaces[i] == ws);
+                }
+                if (!found) {
+                    continue;
+                }
+            }
+            criteria_match_con(current_match, con);
         }
-
-        if (accept_match) {
-            TAILQ_INSERT_TAIL(&owindows, current, owindows);
-        } else {
-            FREE(current);
-            continue;
-        }
+        free(workspaces);
     }
 
     TAILQ_FOREACH (current, &owindows, owindows) {
         DLOG("matching: %p / %s\n", current->con, current->con->name);
+        /* Criteria can select containers on invisible workspaces, which
+         * need to be pushed to X11 after the command modified them. */
+        con_mark_dirty(current->con);
     }
 }
 
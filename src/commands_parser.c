@@ -450,6 +450,9 @@ void command_result_free(CommandResult *result) {
 
 #ifdef TEST_PARSER
 
+/* The test binary always prints debug messages. */
+uint32_t debuglog_mask = UINT32_MAX;
+
 /*
  * Logs the given message to stdout while prefixing the current time to it,
  * but only if debug logging was activated.
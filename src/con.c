@@ -14,6 +14,29 @@
 
 static void con_on_remove_child(Con *con);
 
+/* Indexes for con_by_window_id(), con_by_frame_id() and con_by_con_id(), which
+ * are called for (almost) every X11 event we receive. */
+static struct hashmap cons_by_window_id;
+static struct hashmap cons_by_frame_id;
+static struct hashmap cons_by_con_id;
+/* Index for con_by_mark(). Marks are unique, so every mark belongs to exactly
+ * one container. */
+static struct hashmap cons_by_mark;
+
+struct all_marks_head all_marks = TAILQ_HEAD_INITIALIZER(all_marks);
+
+/*
+ * Removes the given mark from the container and the indexes and frees it.
+ *
+ */
+static void con_remove_mark(Con *con, mark_t *mark) {
+    TAILQ_REMOVE(&(con->marks_head), mark, marks);
+    TAILQ_REMOVE(&all_marks, mark, all_marks);
+    hashmap_remove_string(&cons_by_mark, mark->name);
+    FREE(mark->name);
+    FREE(mark);
+}
+
 /*
  * force parent split containers to be redrawn
  *
@@ -39,8 +62,9 @@ Con *con_new_skeleton(Con *parent, i3Window *window) {
     Con *new = scalloc(1, sizeof(Con));
     new->on_remove_child = con_on_remove_child;
     TAILQ_INSERT_TAIL(&all_cons, new, all_cons);
+    hashmap_put(&cons_by_con_id, (uintptr_t)new, new);
     new->type = CT_CON;
-    new->window = window;
+    con_set_window(new, window);
     new->border_style = new->max_user_border_style = config.default_border;
     new->current_border_width = -1;
     new->window_icon_padding = -1;
@@ -79,7 +103,11 @@ Con *con_new(Con *parent, i3Window *window) {
 void con_free(Con *con) {
     free(con->name);
     FREE(con->deco_render_params);
+    FREE(con->json_cache);
     TAILQ_REMOVE(&all_cons, con, all_cons);
+    hashmap_remove(&cons_by_con_id, (uintptr_t)con);
+    ipc_forget_con(con);
+    con_set_window(con, NULL);
     while (!TAILQ_EMPTY(&(con->swallow_head))) {
         Match *match = TAILQ_FIRST(&(con->swallow_head));
         TAILQ_REMOVE(&(con->swallow_head), match, matches);
@@ -87,10 +115,7 @@ void con_free(Con *con) {
         free(match);
     }
     while (!TAILQ_EMPTY(&(con->marks_head))) {
-        mark_t *mark = TAILQ_FIRST(&(con->marks_head));
-        TAILQ_REMOVE(&(con->marks_head), mark, marks);
-        FREE(mark->name);
-        FREE(mark);
+        con_remove_mark(con, TAILQ_FIRST(&(con->marks_head)));
     }
     DLOG("con %p freed\n", con);
     free(con);
@@ -98,6 +123,7 @@ void con_free(Con *con) {
 
 static void _con_attach(Con *con, Con *parent, Con *previous, bool ignore_focus) {
     con->parent = parent;
+    con_mark_dirty(con);
     Con *loop;
     Con *current = previous;
     struct nodes_head *nodes_head = &(parent->nodes_head);
@@ -107,6 +133,9 @@ static void _con_attach(Con *con, Con *parent, Con *previous, bool ignore_focus)
      * right position. */
     if (con->type == CT_WORKSPACE) {
         DLOG("it's a workspace. num = %d\n", con->num);
+        if (parent->type == CT_CON) {
+            workspace_index_add(con);
+        }
         if (con->num == -1 || TAILQ_EMPTY(nodes_head)) {
             TAILQ_INSERT_TAIL(nodes_head, con, nodes);
         } else {
@@ -229,6 +258,10 @@ void con_attach(Con *con, Con *parent, bool ignore_focus) {
  */
 void con_detach(Con *con) {
     con_force_split_parents_redraw(con);
+    con_mark_dirty(con);
+    if (con->type == CT_WORKSPACE) {
+        workspace_index_remove(con);
+    }
     if (con->type == CT_FLOATING_CON) {
         TAILQ_REMOVE(&(con->parent->floating_head), con, floating_windows);
         TAILQ_REMOVE(&(con->parent->focus_head), con, focused);
@@ -246,6 +279,7 @@ void con_detach(Con *con) {
 void con_focus(Con *con) {
     assert(con != NULL);
     DLOG("con_focus = %p\n", con);
+    con_mark_dirty(con);
 
     /* 1: set focused-pointer to the new con */
     /* 2: exchange the position of the container in focus stack of the parent all the way up */
@@ -669,13 +703,7 @@ bool con_has_parent(Con *con, Con *parent) {
  *
  */
 Con *con_by_window_id(xcb_window_t window) {
-    Con *con;
-    TAILQ_FOREACH (con, &all_cons, all_cons) {
-        if (con->window != NULL && con->window->id == window) {
-            return con;
-        }
-    }
-    return NULL;
+    return hashmap_get(&cons_by_window_id, window);
 }
 
 /*
@@ -684,14 +712,7 @@ Con *con_by_window_id(xcb_window_t window) {
  *
  */
 Con *con_by_con_id(long target) {
-    Con *con;
-    TAILQ_FOREACH (con, &all_cons, all_cons) {
-        if (con == (Con *)target) {
-            return con;
-        }
-    }
-
-    return NULL;
+    return hashmap_get(&cons_by_con_id, (uintptr_t)target);
 }
 
 /*
@@ -709,13 +730,80 @@ bool con_exists(Con *con) {
  *
  */
 Con *con_by_frame_id(xcb_window_t frame) {
-    Con *con;
-    TAILQ_FOREACH (con, &all_cons, all_cons) {
-        if (con->frame.id == frame) {
-            return con;
+    return hashmap_get(&cons_by_frame_id, frame);
+}
+
+/*
+ * Sets the client window of the given container (window may be NULL) and
+ * updates the index used by con_by_window_id() accordingly. Must be called
+ * while the previous window (if any) has not been freed yet.
+ *
+ */
+void con_set_window(Con *con, i3Window *window) {
+    if (con->window == window) {
+        if (window != NULL) {
+            hashmap_put(&cons_by_window_id, window->id, con);
         }
+        return;
+    }
+
+    if (con->window != NULL && con_by_window_id(con->window->id) == con) {
+        hashmap_remove(&cons_by_window_id, con->window->id);
+    }
+    con->window = window;
+    if (window != NULL) {
+        hashmap_put(&cons_by_window_id, window->id, con);
+    }
+    con_mark_dirty(con);
+}
+
+/*
+ * Marks the workspace of the given container as changed, so that the next
+ * tree_render() pushes it to X11 even if it is not visible. Invisible
+ * workspaces which were not marked are skipped entirely.
+ *
+ */
+void con_mark_dirty(Con *con) {
+    Con *ws = con_get_workspace(con);
+    if (ws != NULL) {
+        ws->dirty = true;
+    }
+}
+
+/*
+ * Returns true if rendering and pushing the given container can be skipped,
+ * that is, if it is a workspace which is not visible and which was not changed
+ * since the last tree_render() (see con_mark_dirty()).
+ *
+ */
+bool con_is_render_clean(Con *con) {
+    if (con->type != CT_WORKSPACE || con->dirty) {
+        return false;
+    }
+    /* Only the visible workspace of an output (and workspaces which were
+     * never shown) are in CF_OUTPUT mode, see workspace_show(). This saves
+     * the tree walk of workspace_is_visible() in the common case. */
+    return con->fullscreen_mode != CF_OUTPUT || !workspace_is_visible(con);
+}
+
+/*
+ * Adds the frame of the given container to the index used by
+ * con_by_frame_id(). Called by x_con_init() once the frame was created.
+ *
+ */
+void con_index_frame(Con *con) {
+    hashmap_put(&cons_by_frame_id, con->frame.id, con);
+}
+
+/*
+ * Removes the frame of the given container from the index used by
+ * con_by_frame_id(). Called by x_con_kill() and x_con_reframe().
+ *
+ */
+void con_unindex_frame(Con *con) {
+    if (con_by_frame_id(con->frame.id) == con) {
+        hashmap_remove(&cons_by_frame_id, con->frame.id);
     }
-    return NULL;
 }
 
 /*
@@ -724,13 +812,7 @@ Con *con_by_frame_id(xcb_window_t frame) {
  *
  */
 Con *con_by_mark(const char *mark) {
-    Con *con;
-    TAILQ_FOREACH (con, &all_cons, all_cons) {
-        if (con_has_mark(con, mark))
-            return con;
-    }
-
-    return NULL;
+    return hashmap_get_string(&cons_by_mark, mark);
 }
 
 /*
@@ -821,6 +903,8 @@ void con_mark(Con *con, const char *mark, mark_mode_t mode) {
     mark_t *new = scalloc(1, sizeof(mark_t));
     new->name = sstrdup(mark);
     TAILQ_INSERT_TAIL(&(con->marks_head), new, marks);
+    TAILQ_INSERT_TAIL(&all_marks, new, all_marks);
+    hashmap_put_string(&cons_by_mark, mark, con);
     ipc_send_window_event("mark", con);
 
     con->mark_changed = true;
@@ -844,12 +928,8 @@ void con_unmark(Con *con, const char *name) {
             if (TAILQ_EMPTY(&(current->marks_head)))
                 continue;
 
-            mark_t *mark;
             while (!TAILQ_EMPTY(&(current->marks_head))) {
-                mark = TAILQ_FIRST(&(current->marks_head));
-                FREE(mark->name);
-                TAILQ_REMOVE(&(current->marks_head), mark, marks);
-                FREE(mark);
+                con_remove_mark(current, TAILQ_FIRST(&(current->marks_head)));
 
                 ipc_send_window_event("mark", current);
             }
@@ -872,9 +952,7 @@ void con_unmark(Con *con, const char *name) {
             if (strcmp(mark->name, name) != 0)
                 continue;
 
-            FREE(mark->name);
-            TAILQ_REMOVE(&(current->marks_head), mark, marks);
-            FREE(mark);
+            con_remove_mark(current, mark);
 
             ipc_send_window_event("mark", current);
             break;
@@ -1846,6 +1924,7 @@ void con_set_border_style(Con *con, border_style_t border_style, int border_widt
     if (border_style > con->max_user_border_style) {
         border_style = con->max_user_border_style;
     }
+    con_mark_dirty(con);
 
     /* Handle the simple case: non-floating containerns */
     if (!con_is_floating(con)) {
@@ -1883,6 +1962,7 @@ void con_set_border_style(Con *con, border_style_t border_style, int border_widt
 void con_set_layout(Con *con, layout_t layout) {
     DLOG("con_set_layout(%p, %d), con->type = %d\n",
          con, layout, con->type);
+    con_mark_dirty(con);
 
     /* Users can focus workspaces, but not any higher in the hierarchy.
      * Focus on the workspace is a special case, since in every other case, the
@@ -2081,7 +2161,7 @@ static void con_on_remove_child(Con *con) {
             const unsigned char *payload;
             ylength length;
             y(get_buf, &payload, &length);
-            ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, (const char *)payload);
+            ipc_send_event(I3_IPC_EVENT_WORKSPACE, (const char *)payload);
 
             y(free);
         }
@@ -2284,12 +2364,7 @@ void con_set_urgency(Con *con, bool urgent) {
         DLOG("Discarding urgency WM_HINT because timer is running\n");
 
     if (con->window) {
-        if (con->urgent) {
-            gettimeofday(&con->window->urgent, NULL);
-        } else {
-            con->window->urgent.tv_sec = 0;
-            con->window->urgent.tv_usec = 0;
-        }
+        window_set_urgent(con->window, con->urgent);
     }
 
     con_update_parents_urgency(con);
@@ -2553,8 +2628,9 @@ uint32_t con_rect_size_in_orientation(Con *con) {
  *
  */
 void con_merge_into(Con *old, Con *new) {
-    new->window = old->window;
-    old->window = NULL;
+    i3Window *window = old->window;
+    con_set_window(old, NULL);
+    con_set_window(new, window);
 
     if (old->title_format) {
         FREE(new->title_format);
@@ -2572,13 +2648,16 @@ void con_merge_into(Con *old, Con *new) {
 
     con_set_urgency(new, old->urgent);
 
-    mark_t *mark;
-    TAILQ_FOREACH (mark, &(old->marks_head), marks) {
+    new->mark_changed = (TAILQ_FIRST(&(old->marks_head)) != NULL);
+    /* Inserting a mark into the new list resets its next pointer, so we
+     * cannot use TAILQ_FOREACH here. */
+    while (!TAILQ_EMPTY(&(old->marks_head))) {
+        mark_t *mark = TAILQ_FIRST(&(old->marks_head));
+        TAILQ_REMOVE(&(old->marks_head), mark, marks);
         TAILQ_INSERT_TAIL(&(new->marks_head), mark, marks);
+        hashmap_put_string(&cons_by_mark, mark->name, new);
         ipc_send_window_event("mark", new);
     }
-    new->mark_changed = (TAILQ_FIRST(&(old->marks_head)) != NULL);
-    TAILQ_INIT(&(old->marks_head));
 
     tree_close_internal(old, DONT_KILL_WINDOW, false);
 }
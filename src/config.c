@@ -8,6 +8,7 @@
  *           the correct path, switching key bindings mode).
  *
  */
+#define I3_LOG_CATEGORY LOG_CATEGORY_CONFIG
 #include "all.h"
 
 #include <libgen.h>
@@ -275,6 +276,7 @@ bool load_configuration(const char *override_configpath, config_load_t load_type
 
     extract_workspace_names_from_bindings();
     reorder_bindings();
+    reindex_assignments();
 
     if (config.font.type == FONT_TYPE_NONE && load_type != C_VALIDATE) {
         ELOG("You did not specify required configuration option \"font\"\n");
@@ -7,6 +7,7 @@
  * config_directives.c: all config storing functions (see config_parser.c)
  *
  */
+#define I3_LOG_CATEGORY LOG_CATEGORY_CONFIG
 #include "all.h"
 
 #include <wordexp.h>
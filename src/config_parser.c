@@ -23,6 +23,7 @@
  *    nearest <error> token.
  *
  */
+#define I3_LOG_CATEGORY LOG_CATEGORY_CONFIG
 #include "all.h"
 
 #include <fcntl.h>
@@ -515,6 +516,9 @@ static void parse_config(struct parser_ctx *ctx, const char *input, struct conte
 
 #ifdef TEST_PARSER
 
+/* The test binary always prints debug messages. */
+uint32_t debuglog_mask = UINT32_MAX;
+
 /*
  * Logs the given message to stdout while prefixing the current time to it,
  * but only if debug logging was activated.
@@ -240,20 +240,68 @@ void ewmh_update_workarea(void) {
     xcb_delete_property(conn, root, A__NET_WORKAREA);
 }
 
+/* The contents of a window list property as last set on the root window. */
+struct window_list {
+    xcb_window_t *windows;
+    int count;
+    /* False until the property was set for the first time. Until then, the
+     * property may still contain the windows of a previous i3 instance. */
+    bool initialized;
+};
+
+/*
+ * Sets the given window list property on the root window, unless it already
+ * has exactly these contents. Every change wakes up all pagers and taskbars,
+ * so when windows were only added at the end (e.g. a new window was mapped),
+ * only the new windows are appended. The first update always replaces the
+ * property.
+ *
+ */
+static void ewmh_update_window_list(xcb_atom_t property, struct window_list *current,
+                                    xcb_window_t *list, int num_windows) {
+    const bool is_prefix = (current->initialized &&
+                            num_windows >= current->count &&
+                            (current->count == 0 ||
+                             memcmp(list, current->windows, sizeof(xcb_window_t) * current->count) == 0));
+    if (is_prefix && num_windows == current->count) {
+        return;
+    }
+
+    if (is_prefix) {
+        xcb_change_property(
+            conn,
+            XCB_PROP_MODE_APPEND,
+            root,
+            property,
+            XCB_ATOM_WINDOW,
+            32,
+            num_windows - current->count,
+            list + current->count);
+    } else {
+        xcb_change_property(
+            conn,
+            XCB_PROP_MODE_REPLACE,
+            root,
+            property,
+            XCB_ATOM_WINDOW,
+            32,
+            num_windows,
+            list);
+    }
+
+    current->windows = srealloc(current->windows, sizeof(xcb_window_t) * num_windows);
+    memcpy(current->windows, list, sizeof(xcb_window_t) * num_windows);
+    current->count = num_windows;
+    current->initialized = true;
+}
+
 /*
  * Updates the _NET_CLIENT_LIST hint.
  *
  */
 void ewmh_update_client_list(xcb_window_t *list, int num_windows) {
-    xcb_change_property(
-        conn,
-        XCB_PROP_MODE_REPLACE,
-        root,
-        A__NET_CLIENT_LIST,
-        XCB_ATOM_WINDOW,
-        32,
-        num_windows,
-        list);
+    static struct window_list client_list;
+    ewmh_update_window_list(A__NET_CLIENT_LIST, &client_list, list, num_windows);
 }
 
 /*
@@ -261,15 +309,8 @@ void ewmh_update_client_list(xcb_window_t *list, int num_windows) {
  *
  */
 void ewmh_update_client_list_stacking(xcb_window_t *stack, int num_windows) {
-    xcb_change_property(
-        conn,
-        XCB_PROP_MODE_REPLACE,
-        root,
-        A__NET_CLIENT_LIST_STACKING,
-        XCB_ATOM_WINDOW,
-        32,
-        num_windows,
-        stack);
+    static struct window_list client_list_stacking;
+    ewmh_update_window_list(A__NET_CLIENT_LIST_STACKING, &client_list_stacking, stack, num_windows);
 }
 
 /*
@@ -338,6 +379,11 @@ void ewmh_setup_hints(void) {
 
     xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root, A__NET_SUPPORTED, XCB_ATOM_ATOM, 32, /* number of atoms */ sizeof(supported_atoms) / sizeof(xcb_atom_t), supported_atoms);
 
+    /* Drop the client lists of a previous instance (e.g. before an in-place
+     * restart), they are set again once the windows are managed. */
+    xcb_delete_property(conn, root, A__NET_CLIENT_LIST);
+    xcb_delete_property(conn, root, A__NET_CLIENT_LIST_STACKING);
+
     /* We need to map this window to be able to set the input focus to it if no other window is available to be focused. */
     xcb_map_window(conn, ewmh_window);
     xcb_configure_window(conn, ewmh_window, XCB_CONFIG_WINDOW_STACK_MODE, (uint32_t[]){XCB_STACK_MODE_BELOW});
@@ -79,6 +79,8 @@ void floating_check_size(Con *floating_con, bool prefer_height) {
     Rect floating_sane_max_dimensions;
     Con *focused_con = con_descend_focused(floating_con);
 
+    con_mark_dirty(floating_con);
+
     DLOG("deco_rect.height = %d\n", focused_con->deco_rect.height);
     Rect border_rect = con_border_style_rect(focused_con);
     /* We have to do the opposite calculations that render_con() do
@@ -525,6 +527,7 @@ bool floating_maybe_reassign_ws(Con *con) {
  *
  */
 void floating_center(Con *con, Rect rect) {
+    con_mark_dirty(con);
     con->rect.x = rect.x + (rect.width / 2) - (con->rect.width / 2);
     con->rect.y = rect.y + (rect.height / 2) - (con->rect.height / 2);
 }
@@ -748,6 +751,7 @@ bool floating_reposition(Con *con, Rect newrect) {
     }
 
     con->rect = newrect;
+    con_mark_dirty(con);
 
     floating_maybe_reassign_ws(con);
 
@@ -816,4 +820,5 @@ void floating_fix_coordinates(Con *con, Rect *old_rect, Rect *new_rect) {
     con->rect.x = (int32_t)new_rect->x + (double)(rel_x * (int32_t)new_rect->width) / (int32_t)old_rect->width - (int32_t)(con->rect.width / 2);
     con->rect.y = (int32_t)new_rect->y + (double)(rel_y * (int32_t)new_rect->height) / (int32_t)old_rect->height - (int32_t)(con->rect.height / 2);
     DLOG("Resulting coordinates: x = %d, y = %d\n", con->rect.x, con->rect.y);
+    con_mark_dirty(con);
 }
@@ -8,6 +8,7 @@
  *             …).
  *
  */
+#define I3_LOG_CATEGORY LOG_CATEGORY_EVENTS
 #include "all.h"
 
 #include <sys/time.h>
@@ -457,7 +458,7 @@ static void handle_screen_change(xcb_generic_event_t *e) {
 
     scratchpad_fix_resolution();
 
-    ipc_send_event("output", I3_IPC_EVENT_OUTPUT, "{\"change\":\"unspecified\"}");
+    ipc_send_event(I3_IPC_EVENT_OUTPUT, "{\"change\":\"unspecified\"}");
 }
 
 /*
@@ -1149,7 +1150,7 @@ static void handle_configure_notify(xcb_configure_notify_event_t *event) {
     }
     randr_query_outputs();
 
-    ipc_send_event("output", I3_IPC_EVENT_OUTPUT, "{\"change\":\"unspecified\"}");
+    ipc_send_event(I3_IPC_EVENT_OUTPUT, "{\"change\":\"unspecified\"}");
 }
 
 /*
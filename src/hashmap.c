@@ -0,0 +1,232 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * hashmap.c: Open-addressing hash tables used to index containers (and other
+ *            objects) by X11 IDs, pointers or names.
+ *
+ */
+#include "all.h"
+
+/* The table grows once it is more than 70% full. Linear probing stays fast at
+ * that load factor and deletion does not need tombstones (see below). */
+#define HASHMAP_MIN_CAPACITY 64
+
+/*
+ * The finalizer of splitmix64. X11 IDs and pointers have few significant low
+ * bits, so they need to be mixed before they can be used as a bucket index.
+ *
+ */
+static size_t hashmap_slot(const struct hashmap *map, uint64_t key) {
+    key ^= key >> 30;
+    key *= UINT64_C(0xbf58476d1ce4e5b9);
+    key ^= key >> 27;
+    key *= UINT64_C(0x94d049bb133111eb);
+    key ^= key >> 31;
+    return (size_t)key & (map->capacity - 1);
+}
+
+static void hashmap_resize(struct hashmap *map, size_t capacity) {
+    struct hashmap_entry *old_entries = map->entries;
+    size_t old_capacity = map->capacity;
+
+    map->entries = scalloc(capacity, sizeof(struct hashmap_entry));
+    map->capacity = capacity;
+    map->count = 0;
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_entries[i].value != NULL) {
+            hashmap_put(map, old_entries[i].key, old_entries[i].value);
+        }
+    }
+    free(old_entries);
+}
+
+/*
+ * Returns the value stored for the given key or NULL if there is none.
+ *
+ */
+void *hashmap_get(const struct hashmap *map, uint64_t key) {
+    if (map->count == 0) {
+        return NULL;
+    }
+
+    for (size_t i = hashmap_slot(map, key);; i = (i + 1) & (map->capacity - 1)) {
+        struct hashmap_entry *entry = &(map->entries[i]);
+        if (entry->value == NULL) {
+            return NULL;
+        }
+        if (entry->key == key) {
+            return entry->value;
+        }
+    }
+}
+
+/*
+ * Stores the given (non-NULL) value for the given key, replacing any value
+ * which was previously stored for it.
+ *
+ */
+void hashmap_put(struct hashmap *map, uint64_t key, void *value) {
+    assert(value != NULL);
+
+    if ((map->count + 1) * 10 > map->capacity * 7) {
+        hashmap_resize(map, map->capacity == 0 ? HASHMAP_MIN_CAPACITY : map->capacity * 2);
+    }
+
+    for (size_t i = hashmap_slot(map, key);; i = (i + 1) & (map->capacity - 1)) {
+        struct hashmap_entry *entry = &(map->entries[i]);
+        if (entry->value == NULL) {
+            entry->key = key;
+            entry->value = value;
+            map->count++;
+            return;
+        }
+        if (entry->key == key) {
+            entry->value = value;
+            return;
+        }
+    }
+}
+
+/*
+ * Removes the given key from the table. Returns the value that was stored
+ * for it or NULL if there was none.
+ *
+ */
+void *hashmap_remove(struct hashmap *map, uint64_t key) {
+    if (map->count == 0) {
+        return NULL;
+    }
+
+    const size_t mask = map->capacity - 1;
+    size_t i = hashmap_slot(map, key);
+    while (map->entries[i].key != key) {
+        if (map->entries[i].value == NULL) {
+            return NULL;
+        }
+        i = (i + 1) & mask;
+    }
+    if (map->entries[i].value == NULL) {
+        return NULL;
+    }
+
+    void *value = map->entries[i].value;
+    map->count--;
+
+    /* Instead of leaving a tombstone, shift back every following entry of
+     * the probe sequence which could live in the slot we just emptied. */
+    size_t j = i;
+    while (true) {
+        map->entries[i].value = NULL;
+        do {
+            j = (j + 1) & mask;
+            if (map->entries[j].value == NULL) {
+                return value;
+            }
+            /* An entry may move to slot i unless its home slot lies
+             * (cyclically) between i (exclusive) and j (inclusive). */
+        } while (((j - hashmap_slot(map, map->entries[j].key)) & mask) < ((j - i) & mask));
+        map->entries[i] = map->entries[j];
+        i = j;
+    }
+}
+
+/*
+ * Frees all memory used by the table. The values themselves are not freed.
+ *
+ */
+void hashmap_free(struct hashmap *map) {
+    FREE(map->entries);
+    map->capacity = 0;
+    map->count = 0;
+}
+
+/*
+ * Tables keyed by strings store a chain of the following nodes under the hash
+ * of the key, so that keys with the same hash do not overwrite each other.
+ *
+ */
+struct hashmap_string_node {
+    char *key;
+    void *value;
+    struct hashmap_string_node *next;
+};
+
+/* FNV-1a */
+static uint64_t hashmap_string_hash(const char *key) {
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    for (const char *walk = key; *walk != '\0'; walk++) {
+        hash ^= (uint8_t)*walk;
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+/*
+ * Like hashmap_get(), but for tables keyed by strings. A table must either
+ * only be used with the *_string functions or only with the others.
+ *
+ */
+void *hashmap_get_string(const struct hashmap *map, const char *key) {
+    struct hashmap_string_node *node = hashmap_get(map, hashmap_string_hash(key));
+    while (node != NULL && strcmp(node->key, key) != 0) {
+        node = node->next;
+    }
+    return (node == NULL ? NULL : node->value);
+}
+
+/*
+ * Like hashmap_put(), but for tables keyed by strings. The key is copied.
+ *
+ */
+void hashmap_put_string(struct hashmap *map, const char *key, void *value) {
+    assert(value != NULL);
+
+    const uint64_t hash = hashmap_string_hash(key);
+    struct hashmap_string_node *head = hashmap_get(map, hash);
+    for (struct hashmap_string_node *node = head; node != NULL; node = node->next) {
+        if (strcmp(node->key, key) == 0) {
+            node->value = value;
+            return;
+        }
+    }
+
+    struct hashmap_string_node *node = smalloc(sizeof(struct hashmap_string_node));
+    node->key = sstrdup(key);
+    node->value = value;
+    node->next = head;
+    hashmap_put(map, hash, node);
+}
+
+/*
+ * Like hashmap_remove(), but for tables keyed by strings.
+ *
+ */
+void *hashmap_remove_string(struct hashmap *map, const char *key) {
+    const uint64_t hash = hashmap_string_hash(key);
+    struct hashmap_string_node *head = hashmap_get(map, hash);
+    struct hashmap_string_node **link = &head;
+    while (*link != NULL && strcmp((*link)->key, key) != 0) {
+        link = &((*link)->next);
+    }
+
+    struct hashmap_string_node *node = *link;
+    if (node == NULL) {
+        return NULL;
+    }
+
+    *link = node->next;
+    if (head == NULL) {
+        hashmap_remove(map, hash);
+    } else {
+        hashmap_put(map, hash, head);
+    }
+
+    void *value = node->value;
+    free(node->key);
+    free(node);
+    return value;
+}
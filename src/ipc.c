@@ -8,6 +8,7 @@
  *
  */
 
+#define I3_LOG_CATEGORY LOG_CATEGORY_IPC
 #include "all.h"
 #include "yajl_utils.h"
 
@@ -17,6 +18,7 @@
 #include <locale.h>
 #include <stdint.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 
@@ -36,6 +38,101 @@ void ipc_set_kill_timeout(ev_tstamp new) {
     kill_timeout = new;
 }
 
+/* The maximum number of queued messages passed to a single writev() call. */
+#define IPC_MAX_IOVECS 64
+
+/*
+ * Allocates a new message buffer holding the header for the given message
+ * type followed by the payload. The caller owns the only reference.
+ *
+ */
+static ipc_message_buffer *ipc_message_new(size_t size, const uint32_t message_type, const uint8_t *payload) {
+    const i3_ipc_header_t header = {
+        .magic = {'i', '3', '-', 'i', 'p', 'c'},
+        .size = size,
+        .type = message_type};
+    const size_t header_size = sizeof(i3_ipc_header_t);
+
+    ipc_message_buffer *message = smalloc(sizeof(ipc_message_buffer) + header_size + size);
+    message->refcount = 1;
+    message->size = header_size + size;
+    memcpy(message->data, ((void *)&header), header_size);
+    memcpy(message->data + header_size, payload, size);
+    return message;
+}
+
+static void ipc_message_unref(ipc_message_buffer *message) {
+    assert(message->refcount > 0);
+    if (--(message->refcount) == 0) {
+        free(message);
+    }
+}
+
+/*
+ * Removes the first message from the client's output queue.
+ *
+ */
+static void ipc_pop_segment(ipc_client *client) {
+    ipc_output_segment *segment = TAILQ_FIRST(&(client->output));
+    TAILQ_REMOVE(&(client->output), segment, segments);
+    ipc_message_unref(segment->message);
+    free(segment);
+    client->output_offset = 0;
+}
+
+/*
+ * Writes as much of the client's output queue as the socket accepts without
+ * blocking, using one writev() call for up to IPC_MAX_IOVECS messages.
+ * Completely written messages are removed from the queue. Returns the number
+ * of bytes written or -1 on error.
+ *
+ */
+static ssize_t ipc_write_pending(ipc_client *client) {
+    size_t written = 0;
+
+    while (!TAILQ_EMPTY(&(client->output))) {
+        struct iovec iov[IPC_MAX_IOVECS];
+        int iovcnt = 0;
+        ipc_output_segment *segment;
+        TAILQ_FOREACH (segment, &(client->output), segments) {
+            if (iovcnt == IPC_MAX_IOVECS) {
+                break;
+            }
+            const size_t offset = (iovcnt == 0 ? client->output_offset : 0);
+            iov[iovcnt].iov_base = segment->message->data + offset;
+            iov[iovcnt].iov_len = segment->message->size - offset;
+            iovcnt++;
+        }
+
+        ssize_t n = writev(client->fd, iov, iovcnt);
+        if (n == -1) {
+            if (errno == EAGAIN) {
+                break;
+            } else if (errno == EINTR) {
+                continue;
+            } else {
+                return -1;
+            }
+        }
+        written += (size_t)n;
+
+        /* Drop the messages which were written completely and remember how
+         * far we got into the first remaining one. */
+        while (n > 0) {
+            segment = TAILQ_FIRST(&(client->output));
+            const size_t remaining = segment->message->size - client->output_offset;
+            if ((size_t)n < remaining) {
+                client->output_offset += (size_t)n;
+                break;
+            }
+            n -= (ssize_t)remaining;
+            ipc_pop_segment(client);
+        }
+    }
+
+    return written;
+}
+
 /*
  * Try to write the contents of the pending buffer to the client's subscription
  * socket. Will set, reset or clear the timeout and io write callbacks depending
@@ -43,16 +140,14 @@ void ipc_set_kill_timeout(ev_tstamp new) {
  *
  */
 static void ipc_push_pending(ipc_client *client) {
-    const ssize_t result = writeall_nonblock(client->fd, client->buffer, client->buffer_size);
+    const ssize_t result = ipc_write_pending(client);
     if (result < 0) {
         return;
     }
 
-    if ((size_t)result == client->buffer_size) {
+    if (TAILQ_EMPTY(&(client->output))) {
         /* Everything was written successfully: clear the timer and stop the io
          * callback. */
-        FREE(client->buffer);
-        client->buffer_size = 0;
         if (client->timeout) {
             ev_timer_stop(main_loop, client->timeout);
             FREE(client->timeout);
@@ -79,39 +174,68 @@ static void ipc_push_pending(ipc_client *client) {
         ev_timer_set(client->timeout, kill_timeout, 0.0);
         ev_timer_start(main_loop, client->timeout);
     }
-    if (result == 0) {
-        return;
-    }
+}
+
+/*
+ * Appends the given message to the client's output queue, taking a new
+ * reference to it. Also, send the message if the client's queue was empty.
+ *
+ */
+static void ipc_queue_message(ipc_client *client, ipc_message_buffer *message) {
+    const bool push_now = TAILQ_EMPTY(&(client->output));
+
+    ipc_output_segment *segment = smalloc(sizeof(ipc_output_segment));
+    segment->message = message;
+    message->refcount++;
+    TAILQ_INSERT_TAIL(&(client->output), segment, segments);
 
-    /* Shift the buffer to the left and reduce the allocated space. */
-    client->buffer_size -= (size_t)result;
-    memmove(client->buffer, client->buffer + result, client->buffer_size);
-    client->buffer = srealloc(client->buffer, client->buffer_size);
+    if (push_now) {
+        ipc_push_pending(client);
+    }
 }
 
 /*
  * Given a message and a message type, create the corresponding header, merge it
- * with the message and append it to the given client's output buffer. Also,
- * send the message if the client's buffer was empty.
+ * with the message and append it to the given client's output queue. Also,
+ * send the message if the client's queue was empty.
  *
  */
 static void ipc_send_client_message(ipc_client *client, size_t size, const uint32_t message_type, const uint8_t *payload) {
-    const i3_ipc_header_t header = {
-        .magic = {'i', '3', '-', 'i', 'p', 'c'},
-        .size = size,
-        .type = message_type};
-    const size_t header_size = sizeof(i3_ipc_header_t);
-    const size_t message_size = header_size + size;
+    ipc_message_buffer *message = ipc_message_new(size, message_type, payload);
+    ipc_queue_message(client, message);
+    ipc_message_unref(message);
+}
 
-    const bool push_now = (client->buffer_size == 0);
-    client->buffer = srealloc(client->buffer, client->buffer_size + message_size);
-    memcpy(client->buffer + client->buffer_size, ((void *)&header), header_size);
-    memcpy(client->buffer + client->buffer_size + header_size, payload, size);
-    client->buffer_size += message_size;
+/* The bit of an event type in ipc_client.events. */
+#define IPC_EVENT_BIT(message_type) (1U << ((message_type) & ~I3_IPC_EVENT_MASK))
+
+/* The names which clients use to subscribe to events, indexed by event type
+ * (without I3_IPC_EVENT_MASK). */
+static const char *event_names[] = {
+    "workspace",
+    "output",
+    "mode",
+    "window",
+    "barconfig_update",
+    "binding",
+    "shutdown",
+    "tick",
+};
 
-    if (push_now) {
-        ipc_push_pending(client);
+/*
+ * Returns true if at least one client is subscribed to the given event type,
+ * so that callers can skip serializing events nobody is interested in.
+ *
+ */
+static bool ipc_has_subscribers(uint32_t message_type) {
+    const uint32_t event = IPC_EVENT_BIT(message_type);
+    ipc_client *current;
+    TAILQ_FOREACH (current, &all_clients, clients) {
+        if (current->events & event) {
+            return true;
+        }
     }
+    return false;
 }
 
 static void free_ipc_client(ipc_client *client, int exempt_fd) {
@@ -129,12 +253,10 @@ static void free_ipc_client(ipc_client *client, int exempt_fd) {
         FREE(client->timeout);
     }
 
-    free(client->buffer);
-
-    for (int i = 0; i < client->num_events; i++) {
-        free(client->events[i]);
+    while (!TAILQ_EMPTY(&(client->output))) {
+        ipc_pop_segment(client);
     }
-    free(client->events);
+
     TAILQ_REMOVE(&all_clients, client, clients);
     free(client);
 }
@@ -144,15 +266,24 @@ static void free_ipc_client(ipc_client *client, int exempt_fd) {
  * and subscribed to this kind of event.
  *
  */
-void ipc_send_event(const char *event, uint32_t message_type, const char *payload) {
+void ipc_send_event(uint32_t message_type, const char *payload) {
+    const uint32_t event = IPC_EVENT_BIT(message_type);
+    /* The message is only created once and shared by all subscribers. */
+    ipc_message_buffer *message = NULL;
+
     ipc_client *current;
     TAILQ_FOREACH (current, &all_clients, clients) {
-        for (int i = 0; i < current->num_events; i++) {
-            if (strcasecmp(current->events[i], event) == 0) {
-                ipc_send_client_message(current, strlen(payload), message_type, (uint8_t *)payload);
-                break;
-            }
+        if (!(current->events & event)) {
+            continue;
         }
+        if (message == NULL) {
+            message = ipc_message_new(strlen(payload), message_type, (const uint8_t *)payload);
+        }
+        ipc_queue_message(current, message);
+    }
+
+    if (message != NULL) {
+        ipc_message_unref(message);
     }
 }
 
@@ -177,7 +308,7 @@ static void ipc_send_shutdown_event(shutdown_reason_t reason) {
     ylength length;
 
     y(get_buf, &payload, &length);
-    ipc_send_event("shutdown", I3_IPC_EVENT_SHUTDOWN, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_SHUTDOWN, (const char *)payload);
 
     y(free);
 }
@@ -357,7 +488,15 @@ static void dump_binding(yajl_gen gen, Binding *bind) {
     y(map_close);
 }
 
-void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
+static void dump_con_cached(yajl_gen gen, Con *con, bool inplace_restart);
+
+/*
+ * Dumps the given container. If recursive is false, the "nodes" and
+ * "floating_nodes" arrays only contain the IDs of the children instead of
+ * the children themselves.
+ *
+ */
+static void dump_con(yajl_gen gen, Con *con, bool inplace_restart, bool recursive) {
     y(map_open);
     ystr("id");
     y(integer, (uintptr_t)con);
@@ -613,7 +752,10 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
     Con *node;
     if (con->type != CT_DOCKAREA || !inplace_restart) {
         TAILQ_FOREACH (node, &(con->nodes_head), nodes) {
-            dump_node(gen, node, inplace_restart);
+            if (recursive)
+                dump_con_cached(gen, node, inplace_restart);
+            else
+                y(integer, (uintptr_t)node);
         }
     }
     y(array_close);
@@ -621,7 +763,10 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
     ystr("floating_nodes");
     y(array_open);
     TAILQ_FOREACH (node, &(con->floating_head), floating_windows) {
-        dump_node(gen, node, inplace_restart);
+        if (recursive)
+            dump_con_cached(gen, node, inplace_restart);
+        else
+            y(integer, (uintptr_t)node);
     }
     y(array_close);
 
@@ -713,6 +858,312 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
     y(map_close);
 }
 
+/* FNV-1a, used to fingerprint the fields of a container. */
+#define FINGERPRINT_INIT UINT64_C(0xcbf29ce484222325)
+
+static uint64_t fingerprint_bytes(uint64_t hash, const void *data, size_t len) {
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+#define FP(value)                                                 \
+    do {                                                          \
+        __typeof__(value) fp_value = (value);                     \
+        hash = fingerprint_bytes(hash, &fp_value, sizeof(fp_value)); \
+    } while (0)
+
+/* Strings include their terminating NUL byte so that consecutive strings
+ * cannot be confused, NULL is hashed as a single 0xff byte (which does not
+ * occur in UTF-8). */
+#define FP_STR(str)                                                   \
+    do {                                                              \
+        const char *fp_str = (str);                                   \
+        if (fp_str == NULL)                                           \
+            hash = fingerprint_bytes(hash, "\xff", 1);                 \
+        else                                                          \
+            hash = fingerprint_bytes(hash, fp_str, strlen(fp_str) + 1); \
+    } while (0)
+
+#define FP_RECT(r)        \
+    do {                  \
+        FP((r).x);        \
+        FP((r).y);        \
+        FP((r).width);    \
+        FP((r).height);   \
+    } while (0)
+
+/*
+ * Returns a fingerprint of all fields that dump_con() writes for the given
+ * container when called with recursive = false. This is much cheaper than
+ * generating the JSON itself. When changing dump_con(), change this function
+ * accordingly.
+ *
+ */
+static uint64_t con_fingerprint(Con *con, bool inplace_restart) {
+    uint64_t hash = FINGERPRINT_INIT;
+
+    FP(inplace_restart);
+    FP((uintptr_t)con);
+    FP(con->type);
+    FP(con_is_split(con));
+    if (con_is_split(con))
+        FP(con_orientation(con));
+    FP(con->scratchpad_state);
+    FP(con->percent);
+    FP(con->urgent);
+
+    mark_t *mark;
+    TAILQ_FOREACH (mark, &(con->marks_head), marks) {
+        FP_STR(mark->name);
+    }
+    FP_STR(NULL);
+
+    FP(con == focused);
+    if (con->type != CT_ROOT && con->type != CT_OUTPUT)
+        FP_STR(con_get_output(con)->name);
+
+    FP(con->layout);
+    FP(con->workspace_layout);
+    FP(con->border_style);
+    FP(con->current_border_width);
+
+    FP_RECT(con->rect);
+    FP_RECT(con->deco_rect);
+    FP(con_draw_decoration_into_frame(con));
+    if (con_draw_decoration_into_frame(con)) {
+        FP(con->parent->rect.x);
+        FP(con->parent->rect.y);
+    }
+    FP_RECT(con->window_rect);
+    FP_RECT(con->geometry);
+
+    if (con->window && con->window->name)
+        FP_STR(i3string_as_utf8(con->window->name));
+    else
+        FP_STR(con->name);
+    FP_STR(con->title_format);
+    FP(con->window_icon_padding);
+
+    if (con->type == CT_WORKSPACE) {
+        FP(con->num);
+        FP(con->gaps.inner);
+        FP(con->gaps.top);
+        FP(con->gaps.right);
+        FP(con->gaps.bottom);
+        FP(con->gaps.left);
+    }
+
+    FP(con->window != NULL);
+    if (con->window) {
+        FP(con->window->id);
+        FP(con->window->window_type);
+        if (!inplace_restart) {
+            FP_STR(con->window->class_class);
+            FP_STR(con->window->class_instance);
+            FP_STR(con->window->role);
+            FP_STR(con->window->machine);
+            FP_STR(con->window->name ? i3string_as_utf8(con->window->name) : NULL);
+            FP(con->window->transient_for);
+        }
+        if (inplace_restart)
+            FP(con->depth);
+    }
+
+    Con *node;
+    if (con->type != CT_DOCKAREA || !inplace_restart) {
+        TAILQ_FOREACH (node, &(con->nodes_head), nodes) {
+            FP((uintptr_t)node);
+        }
+    }
+    FP((uintptr_t)NULL);
+    TAILQ_FOREACH (node, &(con->floating_head), floating_windows) {
+        FP((uintptr_t)node);
+    }
+    FP((uintptr_t)NULL);
+    TAILQ_FOREACH (node, &(con->focus_head), focused) {
+        FP((uintptr_t)node);
+    }
+    FP((uintptr_t)NULL);
+
+    FP(con->fullscreen_mode);
+    FP(con->sticky);
+    FP(con->floating);
+
+    Match *match;
+    TAILQ_FOREACH (match, &(con->swallow_head), matches) {
+        if (match->restart_mode)
+            continue;
+        FP(match->dock);
+        FP(match->insert_where);
+        FP_STR(match->class ? match->class->pattern : NULL);
+        FP_STR(match->instance ? match->instance->pattern : NULL);
+        FP_STR(match->window_role ? match->window_role->pattern : NULL);
+        FP_STR(match->title ? match->title->pattern : NULL);
+        FP_STR(match->machine ? match->machine->pattern : NULL);
+    }
+    FP_STR(NULL);
+
+    if (inplace_restart && con->type == CT_ROOT)
+        FP_STR(previous_workspace_name);
+
+    return hash;
+}
+
+#undef FP
+#undef FP_STR
+#undef FP_RECT
+
+/*
+ * Computes the fingerprint of the given container including all children
+ * which dump_con() recurses into and stores it in con->subtree_fingerprint.
+ *
+ */
+static uint64_t update_subtree_fingerprint(Con *con, bool inplace_restart) {
+    uint64_t hash = con_fingerprint(con, inplace_restart);
+    uint64_t child_hash;
+
+    Con *node;
+    if (con->type != CT_DOCKAREA || !inplace_restart) {
+        TAILQ_FOREACH (node, &(con->nodes_head), nodes) {
+            child_hash = update_subtree_fingerprint(node, inplace_restart);
+            hash = fingerprint_bytes(hash, &child_hash, sizeof(child_hash));
+        }
+    }
+    TAILQ_FOREACH (node, &(con->floating_head), floating_windows) {
+        child_hash = update_subtree_fingerprint(node, inplace_restart);
+        hash = fingerprint_bytes(hash, &child_hash, sizeof(child_hash));
+    }
+
+    con->subtree_fingerprint = hash;
+    return hash;
+}
+
+/*
+ * Dumps the given container and its children. If the subtree did not change
+ * since it was last dumped, the cached JSON is inserted as-is. Otherwise, the
+ * JSON is generated (again using the caches of unchanged children) and
+ * stored in the cache. Requires con->subtree_fingerprint to be up to date.
+ *
+ */
+static void dump_con_cached(yajl_gen gen, Con *con, bool inplace_restart) {
+    if (con->json_cache != NULL && con->json_cache_fingerprint == con->subtree_fingerprint) {
+        /* yajl_gen_number() inserts its argument verbatim (with the
+         * separator that the current state requires), which is exactly what
+         * we need to splice in a complete JSON value. */
+        y(number, con->json_cache, con->json_cache_length);
+        return;
+    }
+
+    const unsigned char *buf;
+    ylength start, end;
+    y(get_buf, &buf, &start);
+    dump_con(gen, con, inplace_restart, true);
+    y(get_buf, &buf, &end);
+
+    /* Skip the separator which yajl inserted before the value. */
+    if (start < end && (buf[start] == ',' || buf[start] == ':'))
+        start++;
+
+    FREE(con->json_cache);
+    con->json_cache_length = end - start;
+    con->json_cache = smalloc(con->json_cache_length);
+    memcpy(con->json_cache, buf + start, con->json_cache_length);
+    con->json_cache_fingerprint = con->subtree_fingerprint;
+}
+
+void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
+    update_subtree_fingerprint(con, inplace_restart);
+    dump_con_cached(gen, con, inplace_restart);
+}
+
+/* The number of removed containers which are remembered for
+ * GET_TREE_CHANGES. Clients which are further behind get the complete tree. */
+#define MAX_REMOVED_CONS 4096
+
+static struct removed_con {
+    uintptr_t id;
+    uint64_t generation;
+} removed_cons[MAX_REMOVED_CONS];
+static int removed_cons_next = 0;
+
+/* The current tree generation. Changes which were not yet picked up by
+ * update_tree_generation() belong to generation tree_generation + 1. */
+static uint64_t tree_generation = 0;
+/* Whether a container was removed since the last update_tree_generation(). */
+static bool removed_cons_pending = false;
+/* Clients whose generation is older than this may have missed removals. */
+static uint64_t removed_cons_horizon = 0;
+
+/*
+ * Records that the given container is about to be freed, so that clients of
+ * GET_TREE_CHANGES learn about its removal.
+ *
+ */
+void ipc_forget_con(Con *con) {
+    if (con->generation == 0) {
+        /* Never reported to any client. */
+        return;
+    }
+
+    struct removed_con *removed = &removed_cons[removed_cons_next];
+    if (removed->generation > removed_cons_horizon)
+        removed_cons_horizon = removed->generation;
+    removed->id = (uintptr_t)con;
+    removed->generation = tree_generation + 1;
+    removed_cons_next = (removed_cons_next + 1) % MAX_REMOVED_CONS;
+    removed_cons_pending = true;
+}
+
+static bool update_con_generation(Con *con) {
+    bool changed = false;
+    const uint64_t fingerprint = con_fingerprint(con, false);
+    if (con->generation == 0 || con->fingerprint != fingerprint) {
+        con->fingerprint = fingerprint;
+        con->generation = tree_generation + 1;
+        changed = true;
+    }
+
+    Con *child;
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        changed |= update_con_generation(child);
+    }
+    TAILQ_FOREACH (child, &(con->floating_head), floating_windows) {
+        changed |= update_con_generation(child);
+    }
+    return changed;
+}
+
+/*
+ * Compares the fingerprints of all containers in the tree with the ones
+ * stored at the previous call and starts a new generation if anything
+ * changed.
+ *
+ */
+static void update_tree_generation(void) {
+    const bool changed = update_con_generation(croot);
+    if (changed || removed_cons_pending) {
+        tree_generation++;
+        removed_cons_pending = false;
+    }
+}
+
+static void dump_changed_cons(yajl_gen gen, Con *con, uint64_t since) {
+    if (con->generation > since)
+        dump_con(gen, con, false, false);
+
+    Con *child;
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        dump_changed_cons(gen, child, since);
+    }
+    TAILQ_FOREACH (child, &(con->floating_head), floating_windows) {
+        dump_changed_cons(gen, child, since);
+    }
+}
+
 static void dump_bar_bindings(yajl_gen gen, Barconfig *config) {
     if (TAILQ_EMPTY(&(config->bar_bindings)))
         return;
@@ -912,6 +1363,63 @@ IPC_HANDLER(tree) {
     y(free);
 }
 
+/*
+ * Formats the reply message for a GET_TREE_CHANGES request: all containers
+ * which changed after the generation given in the payload (flat, with only
+ * the IDs of their children) and the IDs of all containers removed since.
+ *
+ */
+IPC_HANDLER(get_tree_changes) {
+    char *since_str = sstrndup((const char *)message, message_size);
+    uint64_t since = strtoull(since_str, NULL, 10);
+    free(since_str);
+
+    update_tree_generation();
+
+    /* Clients which are too far behind (or which pass a generation of a
+     * previous i3 instance) get the complete tree. */
+    const bool complete = (since == 0 || since > tree_generation || since < removed_cons_horizon);
+    if (complete)
+        since = 0;
+
+    setlocale(LC_NUMERIC, "C");
+    yajl_gen gen = ygenalloc();
+
+    y(map_open);
+
+    ystr("generation");
+    y(integer, tree_generation);
+
+    ystr("complete");
+    y(bool, complete);
+
+    ystr("nodes");
+    y(array_open);
+    dump_changed_cons(gen, croot, since);
+    y(array_close);
+
+    ystr("removed");
+    y(array_open);
+    if (!complete) {
+        for (int i = 0; i < MAX_REMOVED_CONS; i++) {
+            const struct removed_con *removed = &removed_cons[(removed_cons_next + i) % MAX_REMOVED_CONS];
+            if (removed->generation > since)
+                y(integer, removed->id);
+        }
+    }
+    y(array_close);
+
+    y(map_close);
+    setlocale(LC_NUMERIC, "");
+
+    const unsigned char *payload;
+    ylength length;
+    y(get_buf, &payload, &length);
+
+    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_TREE_CHANGES, payload);
+    y(free);
+}
+
 /*
  * Formats the reply message for a GET_WORKSPACES request and sends it to the
  * client
@@ -1042,12 +1550,9 @@ IPC_HANDLER(get_marks) {
     yajl_gen gen = ygenalloc();
     y(array_open);
 
-    Con *con;
-    TAILQ_FOREACH (con, &all_cons, all_cons) {
-        mark_t *mark;
-        TAILQ_FOREACH (mark, &(con->marks_head), marks) {
-            ystr(mark->name);
-        }
+    mark_t *mark;
+    TAILQ_FOREACH (mark, &all_marks, all_marks) {
+        ystr(mark->name);
     }
 
     y(array_close);
@@ -1197,21 +1702,16 @@ static int add_subscription(void *extra, const unsigned char *s,
     ipc_client *client = extra;
 
     DLOG("should add subscription to extra %p, sub %.*s\n", client, (int)len, s);
-    int event = client->num_events;
-
-    client->num_events++;
-    client->events = srealloc(client->events, client->num_events * sizeof(char *));
-    /* We copy the string because it is not null-terminated and strndup()
-     * is missing on some BSD systems */
-    client->events[event] = scalloc(len + 1, 1);
-    memcpy(client->events[event], s, len);
-
-    DLOG("client is now subscribed to:\n");
-    for (int i = 0; i < client->num_events; i++) {
-        DLOG("event %s\n", client->events[i]);
+    for (size_t i = 0; i < sizeof(event_names) / sizeof(event_names[0]); i++) {
+        if (strlen(event_names[i]) == len &&
+            strncasecmp(event_names[i], (const char *)s, len) == 0) {
+            client->events |= (1U << i);
+            DLOG("client is now subscribed to events 0x%08x\n", client->events);
+            return 1;
+        }
     }
-    DLOG("(done)\n");
 
+    DLOG("ignoring subscription to unknown event %.*s\n", (int)len, s);
     return 1;
 }
 
@@ -1251,14 +1751,7 @@ IPC_HANDLER(subscribe) {
         return;
     }
 
-    bool is_tick = false;
-    for (int i = 0; i < client->num_events; i++) {
-        if (strcmp(client->events[i], "tick") == 0) {
-            is_tick = true;
-            break;
-        }
-    }
-    if (!is_tick) {
+    if (!(client->events & IPC_EVENT_BIT(I3_IPC_EVENT_TICK))) {
         return;
     }
 
@@ -1324,7 +1817,7 @@ IPC_HANDLER(send_tick) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("tick", I3_IPC_EVENT_TICK, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_TICK, (const char *)payload);
     y(free);
 
     const char *reply = "{\"success\":true}";
@@ -1411,7 +1904,7 @@ IPC_HANDLER(get_binding_state) {
 
 /* The index of each callback function corresponds to the numeric
  * value of the message type (see include/i3/ipc.h) */
-handler_t handlers[13] = {
+handler_t handlers[14] = {
     handle_run_command,
     handle_get_workspaces,
     handle_subscribe,
@@ -1425,6 +1918,7 @@ handler_t handlers[13] = {
     handle_send_tick,
     handle_sync,
     handle_get_binding_state,
+    handle_get_tree_changes,
 };
 
 /*
@@ -1563,6 +2057,7 @@ ipc_client *ipc_new_client_on_fd(EV_P_ int fd) {
 
     ipc_client *client = scalloc(1, sizeof(ipc_client));
     client->fd = fd;
+    TAILQ_INIT(&(client->output));
 
     client->read_callback = scalloc(1, sizeof(struct ev_io));
     client->read_callback->data = client;
@@ -1616,13 +2111,17 @@ yajl_gen ipc_marshal_workspace_event(const char *change, Con *current, Con *old)
  * previously focused workspace in "old".
  */
 void ipc_send_workspace_event(const char *change, Con *current, Con *old) {
+    if (!ipc_has_subscribers(I3_IPC_EVENT_WORKSPACE)) {
+        return;
+    }
+
     yajl_gen gen = ipc_marshal_workspace_event(change, current, old);
 
     const unsigned char *payload;
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_WORKSPACE, (const char *)payload);
 
     y(free);
 }
@@ -1634,6 +2133,9 @@ void ipc_send_workspace_event(const char *change, Con *current, Con *old) {
 void ipc_send_window_event(const char *property, Con *con) {
     DLOG("Issue IPC window %s event (con = %p, window = 0x%08x)\n",
          property, con, (con->window ? con->window->id : XCB_WINDOW_NONE));
+    if (!ipc_has_subscribers(I3_IPC_EVENT_WINDOW)) {
+        return;
+    }
 
     setlocale(LC_NUMERIC, "C");
     yajl_gen gen = ygenalloc();
@@ -1652,7 +2154,7 @@ void ipc_send_window_event(const char *property, Con *con) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("window", I3_IPC_EVENT_WINDOW, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_WINDOW, (const char *)payload);
     y(free);
     setlocale(LC_NUMERIC, "");
 }
@@ -1671,7 +2173,7 @@ void ipc_send_barconfig_update_event(Barconfig *barconfig) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("barconfig_update", I3_IPC_EVENT_BARCONFIG_UPDATE, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_BARCONFIG_UPDATE, (const char *)payload);
     y(free);
     setlocale(LC_NUMERIC, "");
 }
@@ -1681,6 +2183,9 @@ void ipc_send_barconfig_update_event(Barconfig *barconfig) {
  */
 void ipc_send_binding_event(const char *event_type, Binding *bind, const char *modename) {
     DLOG("Issue IPC binding %s event (sym = %s, code = %d)\n", event_type, bind->symbol, bind->keycode);
+    if (!ipc_has_subscribers(I3_IPC_EVENT_BINDING)) {
+        return;
+    }
 
     setlocale(LC_NUMERIC, "C");
 
@@ -1707,7 +2212,7 @@ void ipc_send_binding_event(const char *event_type, Binding *bind, const char *m
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("binding", I3_IPC_EVENT_BINDING, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_BINDING, (const char *)payload);
 
     y(free);
     setlocale(LC_NUMERIC, "");
@@ -32,8 +32,16 @@
 #include <sys/sysctl.h>
 #endif
 
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 static bool debug_logging = false;
 static bool verbose = false;
+/* The categories selected using -d (all of them by default). */
+static uint32_t debug_categories = UINT32_MAX;
+uint32_t debuglog_mask = 0;
 static FILE *errorfile;
 char *errorfilename;
 
@@ -49,6 +57,20 @@ int shmlog_size = 0;
 static char *logbuffer;
 /* A pointer (within logbuffer) where data will be written to next. */
 static char *logwalk;
+/* A pointer (within logbuffer) to the end of the ring buffer. In the binary
+ * format, the table of format strings starts here. */
+static char *logend;
+/* The format of the SHM log, SHMLOG_FORMAT_TEXT or SHMLOG_FORMAT_BINARY. */
+static uint32_t shmlog_format = SHMLOG_FORMAT_TEXT;
+/* SHMLOG_FORMAT_BINARY only: maps format strings (by address) to their id in
+ * the SHM log, or to UINT32_MAX if they cannot be stored in binary form. */
+static struct hashmap shmlog_format_ids;
+/* SHMLOG_FORMAT_BINARY only: the oldest record of the previous pass through
+ * the ring buffer which was not overwritten yet, or NULL if there is none. */
+static char *logoldest;
+/* SHMLOG_FORMAT_BINARY only: sequence number of the first record of the
+ * current pass through the ring buffer. */
+static uint64_t logpass_first_record;
 /* A pointer to the shmlog header */
 static i3_shmlog_header *header;
 /* A pointer to the byte where we last wrapped. Necessary to not print the
@@ -73,6 +95,27 @@ log_clients = TAILQ_HEAD_INITIALIZER(log_clients);
 
 void log_broadcast_to_clients(const char *message, size_t len);
 
+/* Indexed by log_category_t. */
+static const char *log_category_names[LOG_CATEGORY_COUNT] = {
+    [LOG_CATEGORY_GENERAL] = "general",
+    [LOG_CATEGORY_BINDINGS] = "bindings",
+    [LOG_CATEGORY_CONFIG] = "config",
+    [LOG_CATEGORY_EVENTS] = "events",
+    [LOG_CATEGORY_IPC] = "ipc",
+    [LOG_CATEGORY_MATCH] = "match",
+    [LOG_CATEGORY_RANDR] = "randr",
+    [LOG_CATEGORY_RENDER] = "render",
+};
+
+/*
+ * Recomputes debuglog_mask, which needs to be done whenever debug logging is
+ * switched on/off, the categories change or the SHM log is opened/closed.
+ *
+ */
+static void update_debuglog_mask(void) {
+    debuglog_mask = (logbuffer != NULL || debug_logging ? debug_categories : 0);
+}
+
 /*
  * Writes the offsets for the next write and for the last wrap to the
  * shmlog_header.
@@ -85,6 +128,28 @@ static void store_log_markers(void) {
     header->size = logbuffer_size;
 }
 
+/*
+ * Marks the start of a write to the SHM log, see i3_shmlog_header.sequence.
+ *
+ */
+static void shmlog_write_begin(void) {
+    __atomic_store_n(&(header->sequence), header->sequence + 1, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Marks the end of a write to the SHM log and wakes up readers waiting for
+ * new messages.
+ *
+ */
+static void shmlog_write_end(void) {
+    __atomic_store_n(&(header->sequence), header->sequence + 1, __ATOMIC_SEQ_CST);
+#if defined(__linux__)
+    if (__atomic_load_n(&(header->waiters), __ATOMIC_SEQ_CST) > 0) {
+        syscall(SYS_futex, &(header->sequence), FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+#endif
+}
+
 /*
  * Initializes logging by creating an error logfile in /tmp (or
  * XDG_RUNTIME_DIR, see get_process_filename()).
@@ -177,10 +242,31 @@ void open_logbuffer(void) {
     memset(logbuffer, '\0', logbuffer_size);
 
     header = (i3_shmlog_header *)logbuffer;
-
-    logwalk = logbuffer + sizeof(i3_shmlog_header);
-    loglastwrap = logbuffer + logbuffer_size;
+    header->format = shmlog_format;
+
+    if (shmlog_format == SHMLOG_FORMAT_BINARY) {
+        /* Reserve 1/16 of the log (but at most 1 MiB) for format strings.
+         * There are fewer than 3000 log statements in i3. */
+        int formats_size = logbuffer_size / 16;
+        if (formats_size > 1024 * 1024) {
+            formats_size = 1024 * 1024;
+        }
+        header->offset_formats = (logbuffer_size - formats_size) & ~(SHMLOG_ALIGNMENT - 1);
+        header->formats_size = 0;
+        hashmap_free(&shmlog_format_ids);
+
+        logend = logbuffer + header->offset_formats;
+        logwalk = logbuffer + SHMLOG_ALIGN(sizeof(i3_shmlog_header));
+        logoldest = NULL;
+        logpass_first_record = 0;
+        header->offset_oldest = (logwalk - logbuffer);
+    } else {
+        logend = logbuffer + logbuffer_size;
+        logwalk = logbuffer + sizeof(i3_shmlog_header);
+    }
+    loglastwrap = logend;
     store_log_markers();
+    update_debuglog_mask();
 }
 
 /*
@@ -193,6 +279,23 @@ void close_logbuffer(void) {
     free(shmlogname);
     logbuffer = NULL;
     shmlogname = "";
+    update_debuglog_mask();
+}
+
+/*
+ * Sets the format of the SHM log (SHMLOG_FORMAT_TEXT or SHMLOG_FORMAT_BINARY).
+ * An already open SHM log is re-created in the new format.
+ *
+ */
+void set_shmlog_format(uint32_t format) {
+    if (format == shmlog_format) {
+        return;
+    }
+    shmlog_format = format;
+    if (logbuffer != NULL) {
+        close_logbuffer();
+        open_logbuffer();
+    }
 }
 
 /*
@@ -219,6 +322,270 @@ bool get_debug_logging(void) {
  */
 void set_debug_logging(const bool _debug_logging) {
     debug_logging = _debug_logging;
+    update_debuglog_mask();
+}
+
+/*
+ * Restricts debug logging to the given comma-separated list of categories
+ * (e.g. "bindings,ipc"), or enables all categories for "all". Returns false
+ * if the list contains an unknown category.
+ *
+ */
+bool set_debug_categories(const char *categories) {
+    uint32_t mask = 0;
+    char *copy = sstrdup(categories);
+    char *saveptr = NULL;
+    for (char *name = strtok_r(copy, ",", &saveptr); name != NULL; name = strtok_r(NULL, ",", &saveptr)) {
+        if (strcasecmp(name, "all") == 0) {
+            mask = UINT32_MAX;
+            continue;
+        }
+        int category = 0;
+        while (category < LOG_CATEGORY_COUNT && strcasecmp(name, log_category_names[category]) != 0) {
+            category++;
+        }
+        if (category == LOG_CATEGORY_COUNT) {
+            ELOG("Unknown debug log category \"%s\"\n", name);
+            free(copy);
+            return false;
+        }
+        mask |= (UINT32_C(1) << category);
+    }
+    free(copy);
+
+    debug_categories = mask;
+    update_debuglog_mask();
+    return true;
+}
+
+/*
+ * Appends a record with the given payload to the (binary) SHM log, wrapping
+ * around if necessary.
+ *
+ */
+static void store_record(uint32_t format_id, time_t t, const char *payload, size_t length) {
+    char *ring_start = logbuffer + SHMLOG_ALIGN(sizeof(i3_shmlog_header));
+    const size_t size = SHMLOG_ALIGN(sizeof(i3_shmlog_record) + length);
+    i3_shmlog_record record;
+
+    shmlog_write_begin();
+
+    if (size >= (size_t)(logend - logwalk)) {
+        loglastwrap = logwalk;
+        logwalk = ring_start;
+        store_log_markers();
+        header->wrap_count++;
+        /* From now on, the records of the previous pass are overwritten. */
+        logoldest = ring_start;
+        logpass_first_record = header->next_record;
+    }
+
+    /* Before overwriting them, tell readers which records are gone. */
+    if (logoldest != NULL) {
+        while (logoldest < loglastwrap && logoldest < logwalk + size) {
+            memcpy(&record, logoldest, sizeof(i3_shmlog_record));
+            logoldest += SHMLOG_ALIGN(sizeof(i3_shmlog_record) + record.length);
+        }
+        uint64_t oldest_record = logpass_first_record;
+        if (logoldest < loglastwrap) {
+            memcpy(&record, logoldest, sizeof(i3_shmlog_record));
+            oldest_record = record.sequence;
+        } else {
+            logoldest = NULL;
+        }
+        header->offset_oldest = ((logoldest != NULL ? logoldest : ring_start) - logbuffer);
+        __atomic_store_n(&(header->oldest_record), oldest_record, __ATOMIC_SEQ_CST);
+    }
+
+    record = (i3_shmlog_record){
+        .format_id = format_id,
+        .length = length,
+        .time = t,
+        .sequence = header->next_record,
+    };
+    memcpy(logwalk, &record, sizeof(i3_shmlog_record));
+    memcpy(logwalk + sizeof(i3_shmlog_record), payload, length);
+    logwalk += size;
+
+    store_log_markers();
+    __atomic_store_n(&(header->next_record), header->next_record + 1, __ATOMIC_SEQ_CST);
+
+    shmlog_write_end();
+}
+
+/*
+ * Returns the id of the given format string in the (binary) SHM log, adding it
+ * to the table of format strings if necessary. Returns UINT32_MAX if the
+ * format string cannot be stored in binary form or the table is full.
+ *
+ */
+static uint32_t shmlog_format_id(const char *fmt) {
+    void *value = hashmap_get(&shmlog_format_ids, (uintptr_t)fmt);
+    if (value != NULL) {
+        return (uint32_t)(uintptr_t)value;
+    }
+
+    bool supported = true;
+    printf_conversion_t conv;
+    for (const char *walk = fmt; (walk = next_printf_conversion(walk, &conv)) != NULL; walk += conv.length) {
+        if (conv.type == PRINTF_ARG_UNSUPPORTED) {
+            supported = false;
+        }
+    }
+
+    uint32_t id = UINT32_MAX;
+    const uint32_t length = strlen(fmt) + 1;
+    const uint32_t size = SHMLOG_ALIGN(sizeof(uint32_t) + length);
+    if (supported && header->formats_size + size <= (uint32_t)logbuffer_size - header->offset_formats) {
+        id = header->offset_formats + header->formats_size;
+        memcpy(logbuffer + id, &length, sizeof(uint32_t));
+        memcpy(logbuffer + id + sizeof(uint32_t), fmt, length);
+        header->formats_size += size;
+    }
+    hashmap_put(&shmlog_format_ids, (uintptr_t)fmt, (void *)(uintptr_t)id);
+    return id;
+}
+
+/*
+ * Stores the given message in the (binary) SHM log without formatting it: the
+ * arguments are stored as described in shmlog.h. Returns false if that is not
+ * possible, in which case the message needs to be stored as text.
+ *
+ */
+static bool store_binary_record(time_t t, const char *fmt, va_list args) {
+    static char payload[4096];
+    size_t len = 0;
+
+    const uint32_t id = shmlog_format_id(fmt);
+    if (id == UINT32_MAX) {
+        return false;
+    }
+
+#define STORE(value)                                    \
+    do {                                                \
+        if (len + sizeof(value) > sizeof(payload)) {    \
+            return false;                               \
+        }                                               \
+        memcpy(payload + len, &(value), sizeof(value)); \
+        len += sizeof(value);                           \
+    } while (0)
+
+    printf_conversion_t conv;
+    for (const char *walk = fmt; (walk = next_printf_conversion(walk, &conv)) != NULL; walk += conv.length) {
+        int64_t star = -1;
+        for (int i = 0; i < conv.stars; i++) {
+            star = va_arg(args, int);
+            STORE(star);
+        }
+
+        switch (conv.type) {
+            case PRINTF_ARG_SIGNED: {
+                int64_t value;
+                switch (conv.length_modifier) {
+                    case PRINTF_LENGTH_HH:
+                        value = (signed char)va_arg(args, int);
+                        break;
+                    case PRINTF_LENGTH_H:
+                        value = (short)va_arg(args, int);
+                        break;
+                    case PRINTF_LENGTH_L:
+                        value = va_arg(args, long);
+                        break;
+                    case PRINTF_LENGTH_LL:
+                        value = va_arg(args, long long);
+                        break;
+                    case PRINTF_LENGTH_Z:
+                        value = va_arg(args, ssize_t);
+                        break;
+                    case PRINTF_LENGTH_J:
+                        value = va_arg(args, intmax_t);
+                        break;
+                    case PRINTF_LENGTH_T:
+                        value = va_arg(args, ptrdiff_t);
+                        break;
+                    default:
+                        value = va_arg(args, int);
+                        break;
+                }
+                STORE(value);
+                break;
+            }
+            case PRINTF_ARG_UNSIGNED: {
+                uint64_t value;
+                switch (conv.length_modifier) {
+                    case PRINTF_LENGTH_HH:
+                        value = (unsigned char)va_arg(args, unsigned int);
+                        break;
+                    case PRINTF_LENGTH_H:
+                        value = (unsigned short)va_arg(args, unsigned int);
+                        break;
+                    case PRINTF_LENGTH_L:
+                        value = va_arg(args, unsigned long);
+                        break;
+                    case PRINTF_LENGTH_LL:
+                        value = va_arg(args, unsigned long long);
+                        break;
+                    case PRINTF_LENGTH_Z:
+                        value = va_arg(args, size_t);
+                        break;
+                    case PRINTF_LENGTH_J:
+                        value = va_arg(args, uintmax_t);
+                        break;
+                    case PRINTF_LENGTH_T:
+                        value = (uint64_t)va_arg(args, ptrdiff_t);
+                        break;
+                    default:
+                        value = va_arg(args, unsigned int);
+                        break;
+                }
+                STORE(value);
+                break;
+            }
+            case PRINTF_ARG_CHAR: {
+                const int64_t value = va_arg(args, int);
+                STORE(value);
+                break;
+            }
+            case PRINTF_ARG_DOUBLE: {
+                const double value = va_arg(args, double);
+                STORE(value);
+                break;
+            }
+            case PRINTF_ARG_POINTER: {
+                const uint64_t value = (uintptr_t)va_arg(args, void *);
+                STORE(value);
+                break;
+            }
+            case PRINTF_ARG_STRING: {
+                const char *str = va_arg(args, const char *);
+                uint32_t length = UINT32_MAX;
+                if (str != NULL) {
+                    if (conv.precision >= 0) {
+                        length = strnlen(str, conv.precision);
+                    } else if (conv.precision == -2 && star >= 0) {
+                        length = strnlen(str, star);
+                    } else {
+                        length = strlen(str);
+                    }
+                }
+                STORE(length);
+                if (str != NULL) {
+                    if (len + length > sizeof(payload)) {
+                        return false;
+                    }
+                    memcpy(payload + len, str, length);
+                    len += length;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+#undef STORE
+
+    store_record(id, t, payload, len);
+    return true;
 }
 
 /*
@@ -236,13 +603,38 @@ static void vlog(const bool print, const char *fmt, va_list args) {
     static time_t t;
     static struct tm *tmp;
     static size_t len;
+    /* The time prefix only changes once per second, so it is cached instead
+     * of calling localtime_r() and strftime() for every message. */
+    static char prefix[64];
+    static size_t prefix_len;
+    static time_t prefix_time = (time_t)-1;
 
     /* Get current time */
     t = time(NULL);
-    /* Convert time to local time (determined by the locale) */
-    tmp = localtime_r(&t, &result);
-    /* Generate time prefix */
-    len = strftime(message, sizeof(message), "%x %X - ", tmp);
+
+    /* In the binary SHM log format, messages which are neither printed nor
+     * streamed to i3-dump-log -f do not need to be formatted at all. */
+    if (logbuffer && shmlog_format == SHMLOG_FORMAT_BINARY &&
+        !print && TAILQ_EMPTY(&log_clients)) {
+        va_list args_copy;
+        va_copy(args_copy, args);
+        const bool stored = store_binary_record(t, fmt, args_copy);
+        va_end(args_copy);
+        if (stored) {
+            return;
+        }
+    }
+
+    if (t != prefix_time) {
+        /* Convert time to local time (determined by the locale) */
+        tmp = localtime_r(&t, &result);
+        /* Generate time prefix */
+        prefix_len = strftime(prefix, sizeof(prefix), "%x %X - ", tmp);
+        prefix_time = t;
+    }
+    memcpy(message, prefix, prefix_len);
+    message[prefix_len] = '\0';
+    len = prefix_len;
 
     /*
      * logbuffer  print
@@ -276,21 +668,28 @@ static void vlog(const bool print, const char *fmt, va_list args) {
             message[len - 2] = '\n';
         }
 
-        /* If there is no space for the current message in the ringbuffer, we
-         * need to wrap and write to the beginning again. */
-        if (len >= (size_t)(logbuffer_size - (logwalk - logbuffer))) {
-            loglastwrap = logwalk;
-            logwalk = logbuffer + sizeof(i3_shmlog_header);
-            store_log_markers();
-            header->wrap_count++;
-        }
+        if (shmlog_format == SHMLOG_FORMAT_BINARY) {
+            store_record(0, t, message, len);
+        } else {
+            shmlog_write_begin();
+
+            /* If there is no space for the current message in the ringbuffer, we
+             * need to wrap and write to the beginning again. */
+            if (len >= (size_t)(logend - logwalk)) {
+                loglastwrap = logwalk;
+                logwalk = logbuffer + sizeof(i3_shmlog_header);
+                store_log_markers();
+                header->wrap_count++;
+            }
 
-        /* Copy the buffer, move the write pointer to the byte after our
-         * current message. */
-        strncpy(logwalk, message, len);
-        logwalk += len;
+            /* Copy the buffer, move the write pointer to the byte after our
+             * current message. */
+            strncpy(logwalk, message, len);
+            logwalk += len;
 
-        store_log_markers();
+            store_log_markers();
+            shmlog_write_end();
+        }
 
         if (print)
             fwrite(message, len, 1, stdout);
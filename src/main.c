@@ -276,7 +276,21 @@ static int parse_restart_fd(void) {
     return fd;
 }
 
+/*
+ * Returns the number of milliseconds which passed since the given point in
+ * time (of the monotonic clock).
+ *
+ */
+static double ms_since(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
 int main(int argc, char *argv[]) {
+    struct timespec startup_start;
+    clock_gettime(CLOCK_MONOTONIC, &startup_start);
+
     /* Keep a symbol pointing to the I3_VERSION string constant so that we have
      * it in gdb backtraces. */
     static const char *_i3_version __attribute__((used)) = I3_VERSION;
@@ -306,6 +320,7 @@ int main(int argc, char *argv[]) {
         {"disable-signalhandler", no_argument, 0, 0},
         {"shmlog-size", required_argument, 0, 0},
         {"shmlog_size", required_argument, 0, 0},
+        {"shmlog-binary", no_argument, 0, 0},
         {"get-socketpath", no_argument, 0, 0},
         {"get_socketpath", no_argument, 0, 0},
         {"fake_outputs", required_argument, 0, 0},
@@ -370,6 +385,9 @@ int main(int argc, char *argv[]) {
             case 'd':
                 LOG("Enabling debug logging\n");
                 set_debug_logging(true);
+                /* Unknown categories are reported, all categories stay
+                 * enabled in that case. */
+                set_debug_categories(optarg);
                 break;
             case 'l':
                 /* DEPRECATED, ignored for the next 3 versions (3.e, 3.f, 3.g) */
@@ -416,6 +434,10 @@ int main(int argc, char *argv[]) {
                     init_logging();
                     LOG("Limiting SHM log size to %d bytes\n", shmlog_size);
                     break;
+                } else if (strcmp(long_options[option_index].name, "shmlog-binary") == 0) {
+                    LOG("Using the binary SHM log format\n");
+                    set_shmlog_format(SHMLOG_FORMAT_BINARY);
+                    break;
                 } else if (strcmp(long_options[option_index].name, "restart") == 0) {
                     FREE(layout_path);
                     layout_path = sstrdup(optarg);
@@ -438,6 +460,9 @@ int main(int argc, char *argv[]) {
                 fprintf(stderr, "\t-c <file>   use the provided configfile instead\n");
                 fprintf(stderr, "\t-C          validate configuration file and exit\n");
                 fprintf(stderr, "\t-d all      enable debug output\n");
+                fprintf(stderr, "\t-d <list>   enable debug output for a comma-separated list of\n"
+                                "\t            categories (general, bindings, config, events, ipc,\n"
+                                "\t            match, randr, render)\n");
                 fprintf(stderr, "\t-L <file>   path to the serialized layout during restarts\n");
                 fprintf(stderr, "\t-v          display version and exit\n");
                 fprintf(stderr, "\t-V          enable verbose mode\n");
@@ -457,6 +482,11 @@ int main(int argc, char *argv[]) {
                                 "\tThe default is %d bytes.\n",
                         shmlog_size);
                 fprintf(stderr, "\n");
+                fprintf(stderr, "\t--shmlog-binary\n"
+                                "\tStore log messages in a binary format in the SHM log, which\n"
+                                "\ti3-dump-log formats when reading the log. This is cheaper for\n"
+                                "\ti3 and the SHM log holds more messages.\n");
+                fprintf(stderr, "\n");
                 fprintf(stderr, "\t--replace\n"
                                 "\tReplace an existing window manager.\n");
                 fprintf(stderr, "\n");
@@ -1103,7 +1133,10 @@ int main(int argc, char *argv[]) {
 
             free(event);
         }
+        struct timespec manage_start;
+        clock_gettime(CLOCK_MONOTONIC, &manage_start);
         manage_existing_windows(root);
+        LOG("Managed existing windows in %.3f ms\n", ms_since(&manage_start));
     }
     xcb_ungrab_server(conn);
 
@@ -1198,6 +1231,9 @@ int main(int argc, char *argv[]) {
      * when calling exit() */
     atexit(i3_exit);
 
+    LOG("Startup (%s) took %.3f ms\n",
+        (delete_layout_path ? "in-place restart" : "cold start"), ms_since(&startup_start));
+
     sd_notify(1, "READY=1");
     ev_loop(main_loop, 0);
 
@@ -37,9 +37,34 @@ static void _remove_matches(Con *con) {
     }
 }
 
+/*
+ * The requests which are sent for a window before it can be managed. Their
+ * replies are consumed by manage_window_finish().
+ *
+ */
+struct manage_cookies {
+    xcb_get_geometry_cookie_t geometry;
+    xcb_shape_query_extents_cookie_t shape;
+
+    xcb_get_property_cookie_t wm_type, strut, state, utf8_title, title, class,
+        leader, transient, role, startup_id, wm_hints, wm_normal_hints,
+        motif_wm_hints, wm_user_time, wm_desktop, wm_machine, wm_icon,
+        wm_protocols;
+};
+
+static bool manage_window_wanted(xcb_window_t window, xcb_get_window_attributes_reply_t *attr, bool needs_to_be_mapped);
+static void manage_window_request(xcb_window_t window, struct manage_cookies *cookies);
+static void manage_window_finish(xcb_window_t window, xcb_get_window_attributes_reply_t *attr, struct manage_cookies *cookies);
+
 /*
  * Go through all existing windows (if the window manager is restarted) and manage them
  *
+ * To not wait for a round trip to the X server per request, this works in
+ * stages: first, the attributes and geometry of all windows are requested.
+ * Then, the event mask and properties of every window which needs to be
+ * managed are requested. Only then, the replies are consumed one window at a
+ * time.
+ *
  */
 void manage_existing_windows(xcb_window_t root) {
     xcb_query_tree_reply_t *reply;
@@ -53,18 +78,42 @@ void manage_existing_windows(xcb_window_t root) {
 
     len = xcb_query_tree_children_length(reply);
     cookies = smalloc(len * sizeof(*cookies));
+    struct manage_cookies *manage_cookies = smalloc(len * sizeof(struct manage_cookies));
+    xcb_get_window_attributes_reply_t **attrs = scalloc(len, sizeof(xcb_get_window_attributes_reply_t *));
 
-    /* Request the window attributes for every window */
+    /* Request the window attributes and geometry for every window */
     children = xcb_query_tree_children(reply);
-    for (i = 0; i < len; ++i)
+    for (i = 0; i < len; ++i) {
         cookies[i] = xcb_get_window_attributes(conn, children[i]);
+        manage_cookies[i].geometry = xcb_get_geometry(conn, children[i]);
+    }
+
+    /* Request everything else for the windows which we will manage */
+    int wanted = 0;
+    for (i = 0; i < len; ++i) {
+        DLOG("window 0x%08x\n", children[i]);
+        attrs[i] = xcb_get_window_attributes_reply(conn, cookies[i], 0);
+        if (!manage_window_wanted(children[i], attrs[i], true)) {
+            xcb_discard_reply(conn, manage_cookies[i].geometry.sequence);
+            FREE(attrs[i]);
+            continue;
+        }
+        manage_window_request(children[i], &(manage_cookies[i]));
+        wanted++;
+    }
+    LOG("Managing %d of %d existing windows\n", wanted, len);
 
-    /* Call manage_window with the attributes for every window */
-    for (i = 0; i < len; ++i)
-        manage_window(children[i], cookies[i], true);
+    /* Manage the windows */
+    for (i = 0; i < len; ++i) {
+        if (attrs[i] != NULL) {
+            manage_window_finish(children[i], attrs[i], &(manage_cookies[i]));
+        }
+    }
 
     free(reply);
     free(cookies);
+    free(manage_cookies);
+    free(attrs);
 }
 
 /*
@@ -107,54 +156,56 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
                    bool needs_to_be_mapped) {
     DLOG("window 0x%08x\n", window);
 
-    xcb_drawable_t d = {window};
-    xcb_get_geometry_cookie_t geomc;
-    xcb_get_geometry_reply_t *geom;
-    xcb_get_window_attributes_reply_t *attr = NULL;
-
-    xcb_get_property_cookie_t wm_type_cookie, strut_cookie, state_cookie,
-        utf8_title_cookie, title_cookie,
-        class_cookie, leader_cookie, transient_cookie,
-        role_cookie, startup_id_cookie, wm_hints_cookie,
-        wm_normal_hints_cookie, motif_wm_hints_cookie, wm_user_time_cookie, wm_desktop_cookie,
-        wm_machine_cookie;
+    struct manage_cookies cookies;
+    cookies.geometry = xcb_get_geometry(conn, window);
 
-    xcb_get_property_cookie_t wm_icon_cookie;
+    xcb_get_window_attributes_reply_t *attr = xcb_get_window_attributes_reply(conn, cookie, 0);
+    if (!manage_window_wanted(window, attr, needs_to_be_mapped)) {
+        xcb_discard_reply(conn, cookies.geometry.sequence);
+        free(attr);
+        return;
+    }
 
-    geomc = xcb_get_geometry(conn, d);
+    manage_window_request(window, &cookies);
+    manage_window_finish(window, attr, &cookies);
+}
 
+/*
+ * Returns true if the window with the given attributes should be managed.
+ *
+ */
+static bool manage_window_wanted(xcb_window_t window, xcb_get_window_attributes_reply_t *attr, bool needs_to_be_mapped) {
     /* Check if the window is mapped (it could be not mapped when initializing and
        calling manage_window() for every window) */
-    if ((attr = xcb_get_window_attributes_reply(conn, cookie, 0)) == NULL) {
+    if (attr == NULL) {
         DLOG("Could not get attributes\n");
-        xcb_discard_reply(conn, geomc.sequence);
-        return;
+        return false;
     }
 
     if (needs_to_be_mapped && attr->map_state != XCB_MAP_STATE_VIEWABLE) {
-        xcb_discard_reply(conn, geomc.sequence);
-        goto out;
+        return false;
     }
 
     /* Don’t manage clients with the override_redirect flag */
     if (attr->override_redirect) {
-        xcb_discard_reply(conn, geomc.sequence);
-        goto out;
+        return false;
     }
 
     /* Check if the window is already managed */
     if (con_by_window_id(window) != NULL) {
         DLOG("already managed (by con %p)\n", con_by_window_id(window));
-        xcb_discard_reply(conn, geomc.sequence);
-        goto out;
+        return false;
     }
 
-    /* Get the initial geometry (position, size, …) */
-    if ((geom = xcb_get_geometry_reply(conn, geomc, 0)) == NULL) {
-        DLOG("could not get geometry\n");
-        goto out;
-    }
+    return true;
+}
 
+/*
+ * Sets the temporary event mask of the window and requests all the properties
+ * needed to manage it, without waiting for any reply.
+ *
+ */
+static void manage_window_request(xcb_window_t window, struct manage_cookies *cookies) {
     uint32_t values[1];
 
     /* Set a temporary event mask for the new window, consisting only of
@@ -164,36 +215,116 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
      * final event mask.
      * We need StructureNotify because the client may unmap the window before
      * we get to re-parent it.
-     * If this request fails, we assume the client has already unmapped the
-     * window between the MapRequest and our event mask change. */
+     * This request is not checked: the X server processes requests in order,
+     * so if the client destroyed the window between the MapRequest and our
+     * event mask change, the first property request below fails, too (see
+     * manage_window_finish()). The error of this request itself ends up in
+     * the event loop. */
     values[0] = XCB_EVENT_MASK_PROPERTY_CHANGE |
                 XCB_EVENT_MASK_STRUCTURE_NOTIFY;
-    xcb_void_cookie_t event_mask_cookie =
-        xcb_change_window_attributes_checked(conn, window, XCB_CW_EVENT_MASK, values);
-    if (xcb_request_check(conn, event_mask_cookie) != NULL) {
+    xcb_change_window_attributes(conn, window, XCB_CW_EVENT_MASK, values);
+
+#define GET_PROPERTY(atom, len) xcb_get_property(conn, false, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, len)
+
+    cookies->wm_type = GET_PROPERTY(A__NET_WM_WINDOW_TYPE, UINT32_MAX);
+    cookies->strut = GET_PROPERTY(A__NET_WM_STRUT_PARTIAL, UINT32_MAX);
+    cookies->state = GET_PROPERTY(A__NET_WM_STATE, UINT32_MAX);
+    cookies->utf8_title = GET_PROPERTY(A__NET_WM_NAME, 128);
+    cookies->leader = GET_PROPERTY(A_WM_CLIENT_LEADER, UINT32_MAX);
+    cookies->transient = GET_PROPERTY(XCB_ATOM_WM_TRANSIENT_FOR, UINT32_MAX);
+    cookies->title = GET_PROPERTY(XCB_ATOM_WM_NAME, 128);
+    cookies->class = GET_PROPERTY(XCB_ATOM_WM_CLASS, 128);
+    cookies->role = GET_PROPERTY(A_WM_WINDOW_ROLE, 128);
+    cookies->startup_id = GET_PROPERTY(A__NET_STARTUP_ID, 512);
+    cookies->wm_hints = xcb_icccm_get_wm_hints(conn, window);
+    cookies->wm_normal_hints = xcb_icccm_get_wm_normal_hints(conn, window);
+    cookies->motif_wm_hints = GET_PROPERTY(A__MOTIF_WM_HINTS, 5 * sizeof(uint64_t));
+    cookies->wm_user_time = GET_PROPERTY(A__NET_WM_USER_TIME, UINT32_MAX);
+    cookies->wm_desktop = GET_PROPERTY(A__NET_WM_DESKTOP, UINT32_MAX);
+    cookies->wm_machine = GET_PROPERTY(XCB_ATOM_WM_CLIENT_MACHINE, UINT32_MAX);
+    cookies->wm_icon = GET_PROPERTY(A__NET_WM_ICON, UINT32_MAX);
+    cookies->wm_protocols = xcb_icccm_get_wm_protocols(conn, window, A_WM_PROTOCOLS);
+
+#undef GET_PROPERTY
+
+    if (shape_supported) {
+        /* Check if the window is shaped. Sadly, we can check only for the
+         * bounding shape, not for the input shape. */
+        cookies->shape = xcb_shape_query_extents(conn, window);
+    }
+}
+
+/*
+ * Discards the replies of the property requests sent by
+ * manage_window_request(), for windows which will not be managed after all.
+ * The _NET_WM_WINDOW_TYPE reply is always consumed before, so it is skipped.
+ *
+ */
+static void manage_cookies_discard(struct manage_cookies *cookies) {
+    const xcb_get_property_cookie_t property_cookies[] = {
+        cookies->strut, cookies->state, cookies->utf8_title,
+        cookies->title, cookies->class, cookies->leader, cookies->transient,
+        cookies->role, cookies->startup_id, cookies->wm_hints,
+        cookies->wm_normal_hints, cookies->motif_wm_hints, cookies->wm_user_time,
+        cookies->wm_desktop, cookies->wm_machine, cookies->wm_icon,
+        cookies->wm_protocols};
+    for (size_t i = 0; i < sizeof(property_cookies) / sizeof(property_cookies[0]); i++) {
+        xcb_discard_reply(conn, property_cookies[i].sequence);
+    }
+    if (shape_supported) {
+        xcb_discard_reply(conn, cookies->shape.sequence);
+    }
+}
+
+/*
+ * Returns true if the given WM_PROTOCOLS reply contains the given atom.
+ *
+ */
+static bool reply_has_protocol(xcb_get_property_cookie_t cookie, xcb_atom_t atom) {
+    xcb_icccm_get_wm_protocols_reply_t protocols;
+    bool result = false;
+
+    if (xcb_icccm_get_wm_protocols_reply(conn, cookie, &protocols, NULL) != 1)
+        return false;
+
+    for (uint32_t i = 0; i < protocols.atoms_len; i++)
+        if (protocols.atoms[i] == atom)
+            result = true;
+
+    xcb_icccm_get_wm_protocols_reply_wipe(&protocols);
+
+    return result;
+}
+
+/*
+ * Consumes the replies of the requests sent by manage_window_request() and
+ * reparents the window. Frees attr.
+ *
+ */
+static void manage_window_finish(xcb_window_t window, xcb_get_window_attributes_reply_t *attr, struct manage_cookies *cookies) {
+    xcb_get_geometry_reply_t *geom;
+    uint32_t values[1];
+
+    /* The first property request was sent right after the event mask change,
+     * so it only fails if the window was gone by then. */
+    xcb_generic_error_t *error = NULL;
+    xcb_get_property_reply_t *type_reply = xcb_get_property_reply(conn, cookies->wm_type, &error);
+    if (error != NULL) {
         LOG("Could not change event mask, the window probably already disappeared.\n");
+        free(error);
+        free(type_reply);
+        xcb_discard_reply(conn, cookies->geometry.sequence);
+        manage_cookies_discard(cookies);
         goto out;
     }
 
-#define GET_PROPERTY(atom, len) xcb_get_property(conn, false, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, len)
-
-    wm_type_cookie = GET_PROPERTY(A__NET_WM_WINDOW_TYPE, UINT32_MAX);
-    strut_cookie = GET_PROPERTY(A__NET_WM_STRUT_PARTIAL, UINT32_MAX);
-    state_cookie = GET_PROPERTY(A__NET_WM_STATE, UINT32_MAX);
-    utf8_title_cookie = GET_PROPERTY(A__NET_WM_NAME, 128);
-    leader_cookie = GET_PROPERTY(A_WM_CLIENT_LEADER, UINT32_MAX);
-    transient_cookie = GET_PROPERTY(XCB_ATOM_WM_TRANSIENT_FOR, UINT32_MAX);
-    title_cookie = GET_PROPERTY(XCB_ATOM_WM_NAME, 128);
-    class_cookie = GET_PROPERTY(XCB_ATOM_WM_CLASS, 128);
-    role_cookie = GET_PROPERTY(A_WM_WINDOW_ROLE, 128);
-    startup_id_cookie = GET_PROPERTY(A__NET_STARTUP_ID, 512);
-    wm_hints_cookie = xcb_icccm_get_wm_hints(conn, window);
-    wm_normal_hints_cookie = xcb_icccm_get_wm_normal_hints(conn, window);
-    motif_wm_hints_cookie = GET_PROPERTY(A__MOTIF_WM_HINTS, 5 * sizeof(uint64_t));
-    wm_user_time_cookie = GET_PROPERTY(A__NET_WM_USER_TIME, UINT32_MAX);
-    wm_desktop_cookie = GET_PROPERTY(A__NET_WM_DESKTOP, UINT32_MAX);
-    wm_machine_cookie = GET_PROPERTY(XCB_ATOM_WM_CLIENT_MACHINE, UINT32_MAX);
-    wm_icon_cookie = GET_PROPERTY(A__NET_WM_ICON, UINT32_MAX);
+    /* Get the initial geometry (position, size, …) */
+    if ((geom = xcb_get_geometry_reply(conn, cookies->geometry, 0)) == NULL) {
+        DLOG("could not get geometry\n");
+        free(type_reply);
+        manage_cookies_discard(cookies);
+        goto out;
+    }
 
     i3Window *cwindow = scalloc(1, sizeof(i3Window));
     cwindow->id = window;
@@ -204,31 +335,30 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     FREE(buttons);
 
     /* update as much information as possible so far (some replies may be NULL) */
-    window_update_class(cwindow, xcb_get_property_reply(conn, class_cookie, NULL));
-    window_update_name_legacy(cwindow, xcb_get_property_reply(conn, title_cookie, NULL));
-    window_update_name(cwindow, xcb_get_property_reply(conn, utf8_title_cookie, NULL));
-    window_update_icon(cwindow, xcb_get_property_reply(conn, wm_icon_cookie, NULL));
-    window_update_leader(cwindow, xcb_get_property_reply(conn, leader_cookie, NULL));
-    window_update_transient_for(cwindow, xcb_get_property_reply(conn, transient_cookie, NULL));
-    window_update_strut_partial(cwindow, xcb_get_property_reply(conn, strut_cookie, NULL));
-    window_update_role(cwindow, xcb_get_property_reply(conn, role_cookie, NULL));
+    window_update_class(cwindow, xcb_get_property_reply(conn, cookies->class, NULL));
+    window_update_name_legacy(cwindow, xcb_get_property_reply(conn, cookies->title, NULL));
+    window_update_name(cwindow, xcb_get_property_reply(conn, cookies->utf8_title, NULL));
+    window_update_icon(cwindow, xcb_get_property_reply(conn, cookies->wm_icon, NULL));
+    window_update_leader(cwindow, xcb_get_property_reply(conn, cookies->leader, NULL));
+    window_update_transient_for(cwindow, xcb_get_property_reply(conn, cookies->transient, NULL));
+    window_update_strut_partial(cwindow, xcb_get_property_reply(conn, cookies->strut, NULL));
+    window_update_role(cwindow, xcb_get_property_reply(conn, cookies->role, NULL));
     bool urgency_hint;
-    window_update_hints(cwindow, xcb_get_property_reply(conn, wm_hints_cookie, NULL), &urgency_hint);
+    window_update_hints(cwindow, xcb_get_property_reply(conn, cookies->wm_hints, NULL), &urgency_hint);
     border_style_t motif_border_style;
-    bool has_mwm_hints = window_update_motif_hints(cwindow, xcb_get_property_reply(conn, motif_wm_hints_cookie, NULL), &motif_border_style);
-    window_update_normal_hints(cwindow, xcb_get_property_reply(conn, wm_normal_hints_cookie, NULL), geom);
-    window_update_machine(cwindow, xcb_get_property_reply(conn, wm_machine_cookie, NULL));
-    xcb_get_property_reply_t *type_reply = xcb_get_property_reply(conn, wm_type_cookie, NULL);
-    xcb_get_property_reply_t *state_reply = xcb_get_property_reply(conn, state_cookie, NULL);
+    bool has_mwm_hints = window_update_motif_hints(cwindow, xcb_get_property_reply(conn, cookies->motif_wm_hints, NULL), &motif_border_style);
+    window_update_normal_hints(cwindow, xcb_get_property_reply(conn, cookies->wm_normal_hints, NULL), geom);
+    window_update_machine(cwindow, xcb_get_property_reply(conn, cookies->wm_machine, NULL));
+    xcb_get_property_reply_t *state_reply = xcb_get_property_reply(conn, cookies->state, NULL);
 
     xcb_get_property_reply_t *startup_id_reply;
-    startup_id_reply = xcb_get_property_reply(conn, startup_id_cookie, NULL);
+    startup_id_reply = xcb_get_property_reply(conn, cookies->startup_id, NULL);
     char *startup_ws = startup_workspace_for_window(cwindow, startup_id_reply);
     DLOG("startup workspace = %s\n", startup_ws);
 
     /* Get _NET_WM_DESKTOP if it was set. */
     xcb_get_property_reply_t *wm_desktop_reply;
-    wm_desktop_reply = xcb_get_property_reply(conn, wm_desktop_cookie, NULL);
+    wm_desktop_reply = xcb_get_property_reply(conn, cookies->wm_desktop, NULL);
     cwindow->wm_desktop = NET_WM_DESKTOP_NONE;
     if (wm_desktop_reply != NULL && xcb_get_property_value_length(wm_desktop_reply) != 0) {
         uint32_t *wm_desktops = xcb_get_property_value(wm_desktop_reply);
@@ -237,7 +367,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     FREE(wm_desktop_reply);
 
     /* check if the window needs WM_TAKE_FOCUS */
-    cwindow->needs_take_focus = window_supports_protocol(cwindow->id, A_WM_TAKE_FOCUS);
+    cwindow->needs_take_focus = reply_has_protocol(cookies->wm_protocols, A_WM_TAKE_FOCUS);
 
     /* read the preferred _NET_WM_WINDOW_TYPE atom */
     cwindow->window_type = xcb_get_preferred_window_type(type_reply);
@@ -380,11 +510,12 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
         }
     }
     xcb_window_t old_frame = XCB_NONE;
-    if (nc->window != cwindow && nc->window != NULL) {
-        window_free(nc->window);
+    i3Window *old_window = nc->window;
+    con_set_window(nc, cwindow);
+    if (old_window != cwindow && old_window != NULL) {
+        window_free(old_window);
         old_frame = _match_depth(cwindow, nc);
     }
-    nc->window = cwindow;
     x_reinit(nc);
 
     nc->border_width = geom->border_width;
@@ -540,6 +671,12 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     xcb_void_cookie_t rcookie = xcb_reparent_window_checked(conn, window, nc->frame.id, 0, 0);
     if (xcb_request_check(conn, rcookie) != NULL) {
         LOG("Could not reparent the window, aborting\n");
+        /* Do not leave the replies which would have been read later in the
+         * queue. */
+        xcb_discard_reply(conn, cookies->wm_user_time.sequence);
+        if (shape_supported) {
+            xcb_discard_reply(conn, cookies->shape.sequence);
+        }
         goto geom_out;
     }
 
@@ -558,12 +695,8 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
          * shape. */
         xcb_shape_select_input(conn, window, true);
 
-        /* Check if the window is shaped. Sadly, we can check only for the
-         * bounding shape, not for the input shape. */
-        xcb_shape_query_extents_cookie_t cookie =
-            xcb_shape_query_extents(conn, window);
         xcb_shape_query_extents_reply_t *reply =
-            xcb_shape_query_extents_reply(conn, cookie, NULL);
+            xcb_shape_query_extents_reply(conn, cookies->shape, NULL);
         if (reply != NULL && reply->bounding_shaped) {
             cwindow->shaped = true;
         }
@@ -620,7 +753,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
         DLOG("Checking con = %p for _NET_WM_USER_TIME.\n", nc);
 
         uint32_t *wm_user_time;
-        xcb_get_property_reply_t *wm_user_time_reply = xcb_get_property_reply(conn, wm_user_time_cookie, NULL);
+        xcb_get_property_reply_t *wm_user_time_reply = xcb_get_property_reply(conn, cookies->wm_user_time, NULL);
         if (wm_user_time_reply != NULL && xcb_get_property_value_length(wm_user_time_reply) != 0 &&
             (wm_user_time = xcb_get_property_value(wm_user_time_reply)) &&
             wm_user_time[0] == 0) {
@@ -630,7 +763,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
 
         FREE(wm_user_time_reply);
     } else {
-        xcb_discard_reply(conn, wm_user_time_cookie.sequence);
+        xcb_discard_reply(conn, cookies->wm_user_time.sequence);
     }
 
     if (set_focus) {
@@ -708,7 +841,9 @@ Con *remanage_window(Con *con) {
     } else {
         _remove_matches(nc);
     }
-    window_free(nc->window);
+    i3Window *old_window = nc->window;
+    con_set_window(nc, NULL);
+    window_free(old_window);
 
     xcb_window_t old_frame = _match_depth(con->window, nc);
 
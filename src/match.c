@@ -11,12 +11,9 @@
  * match_matches_window() to find the windows affected by this command.
  *
  */
+#define I3_LOG_CATEGORY LOG_CATEGORY_MATCH
 #include "all.h"
 
-/* From sys/time.h, not sure if it’s available on all systems. */
-#define _i3_timercmp(a, b, CMP) \
-    (((a).tv_sec == (b).tv_sec) ? ((a).tv_usec CMP(b).tv_usec) : ((a).tv_sec CMP(b).tv_sec))
-
 /*
  * Initializes the Match data structure. This function is necessary because the
  * members representing boolean values (like dock) need to be initialized with
@@ -140,12 +137,9 @@ bool match_matches_window(Match *match, i3Window *window) {
         if (window->urgent.tv_sec == 0) {
             return false;
         }
-        /* if we find a window that is newer than this one, bail */
-        TAILQ_FOREACH (con, &all_cons, all_cons) {
-            if ((con->window != NULL) &&
-                _i3_timercmp(con->window->urgent, window->urgent, >)) {
-                return false;
-            }
+        /* if there is a window that is newer than this one, bail */
+        if (_i3_timercmp(window_latest_urgent()->urgent, window->urgent, >)) {
+            return false;
         }
         LOG("urgent matches latest\n");
     }
@@ -155,13 +149,9 @@ bool match_matches_window(Match *match, i3Window *window) {
         if (window->urgent.tv_sec == 0) {
             return false;
         }
-        /* if we find a window that is older than this one (and not 0), bail */
-        TAILQ_FOREACH (con, &all_cons, all_cons) {
-            if ((con->window != NULL) &&
-                (con->window->urgent.tv_sec != 0) &&
-                _i3_timercmp(con->window->urgent, window->urgent, <)) {
-                return false;
-            }
+        /* if there is a window that is older than this one, bail */
+        if (_i3_timercmp(window_oldest_urgent()->urgent, window->urgent, <)) {
+            return false;
         }
         LOG("urgent matches oldest\n");
     }
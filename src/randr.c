@@ -9,6 +9,7 @@
  * (take your time to read it completely, it answers all questions).
  *
  */
+#define I3_LOG_CATEGORY LOG_CATEGORY_RANDR
 #include "all.h"
 
 #include <time.h>
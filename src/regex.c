@@ -7,13 +7,20 @@
  * regex.c: Interface to libPCRE (perl compatible regular expressions).
  *
  */
+#define I3_LOG_CATEGORY LOG_CATEGORY_MATCH
 #include "all.h"
 
+/* Shared by all calls of regex_matches(). We only need to know whether a
+ * regular expression matches, so a single pair of offsets is enough. */
+static pcre2_match_data *match_data = NULL;
+static pcre2_match_context *match_context = NULL;
+static pcre2_jit_stack *jit_stack = NULL;
+
 /*
  * Creates a new 'regex' struct containing the given pattern and a PCRE
- * compiled regular expression. Also, calls pcre_study because this regex will
- * most likely be used often (like for every new window and on every relevant
- * property change of existing windows).
+ * compiled regular expression. Also, JIT-compiles the regular expression
+ * because it will most likely be used often (like for every new window and on
+ * every relevant property change of existing windows).
  *
  * Returns NULL if the pattern could not be compiled into a regular expression
  * (and ELOGs an appropriate error message).
@@ -37,6 +44,14 @@ struct regex *regex_new(const char *pattern) {
         regex_free(re);
         return NULL;
     }
+    /* If JIT compilation fails (e.g. because PCRE was built without JIT
+     * support), pcre2_match() uses the interpreter. */
+    int rc = pcre2_jit_compile(re->regex, PCRE2_JIT_COMPLETE);
+    if (rc != 0) {
+        PCRE2_UCHAR buffer[256];
+        pcre2_get_error_message(rc, buffer, sizeof(buffer));
+        DLOG("PCRE JIT compilation of \"%s\" failed: %s\n", pattern, buffer);
+    }
     return re;
 }
 
@@ -48,7 +63,7 @@ void regex_free(struct regex *regex) {
     if (!regex)
         return;
     FREE(regex->pattern);
-    FREE(regex->regex);
+    pcre2_code_free(regex->regex);
     FREE(regex);
 }
 
@@ -59,16 +74,23 @@ void regex_free(struct regex *regex) {
  *
  */
 bool regex_matches(struct regex *regex, const char *input) {
-    pcre2_match_data *match_data;
     int rc;
 
-    match_data = pcre2_match_data_create_from_pattern(regex->regex, NULL);
+    if (match_data == NULL) {
+        match_data = pcre2_match_data_create(1, NULL);
+        /* The default JIT stack of 32 KiB can be too small for complex
+         * patterns, so use one that can grow up to 512 KiB. */
+        match_context = pcre2_match_context_create(NULL);
+        jit_stack = pcre2_jit_stack_create(32 * 1024, 512 * 1024, NULL);
+        pcre2_jit_stack_assign(match_context, NULL, jit_stack);
+    }
 
     /* We use strlen() because pcre_exec() expects the length of the input
      * string in bytes */
-    rc = pcre2_match(regex->regex, (PCRE2_SPTR)input, strlen(input), 0, 0, match_data, NULL);
-    pcre2_match_data_free(match_data);
-    if (rc > 0) {
+    rc = pcre2_match(regex->regex, (PCRE2_SPTR)input, strlen(input), 0, 0, match_data, match_context);
+    /* A return value of 0 means that the match succeeded but match_data is too
+     * small to hold all captured substrings, which we do not need. */
+    if (rc >= 0) {
         LOG("Regular expression \"%s\" matches \"%s\"\n",
             regex->pattern, input);
         return true;
@@ -8,6 +8,7 @@
  *           various rects. Needs to be pushed to X11 (see x.c) to be visible.
  *
  */
+#define I3_LOG_CATEGORY LOG_CATEGORY_RENDER
 #include "all.h"
 
 #include <math.h>
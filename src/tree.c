@@ -258,8 +258,9 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
             add_ignore_event(cookie.sequence, 0);
         }
         ipc_send_window_event("close", con);
-        window_free(con->window);
-        con->window = NULL;
+        i3Window *window = con->window;
+        con_set_window(con, NULL);
+        window_free(window);
     }
 
     Con *ws = con_get_workspace(con);
@@ -430,6 +431,11 @@ bool level_down(void) {
 static void mark_unmapped(Con *con) {
     Con *current;
 
+    /* Clean invisible workspaces are still unmapped from the last run. */
+    if (con_is_render_clean(con)) {
+        return;
+    }
+
     con->mapped = false;
     TAILQ_FOREACH (current, &(con->nodes_head), nodes) {
         mark_unmapped(current);
@@ -443,6 +449,29 @@ static void mark_unmapped(Con *con) {
     }
 }
 
+/*
+ * After the tree was pushed to X11, all invisible workspaces are in sync with
+ * X11 (unmapped). They stay clean until con_mark_dirty() is called for one of
+ * their containers. Visible workspaces always stay dirty, which also ensures
+ * that a workspace is pushed once more after it became invisible.
+ *
+ */
+static void mark_workspaces_clean(void) {
+    Con *output;
+    TAILQ_FOREACH (output, &(croot->nodes_head), nodes) {
+        Con *content = output_get_content(output);
+        if (content == NULL) {
+            continue;
+        }
+
+        Con *visible = con_get_fullscreen_con(content, CF_OUTPUT);
+        Con *ws;
+        TAILQ_FOREACH (ws, &(content->nodes_head), nodes) {
+            ws->dirty = (ws == visible);
+        }
+    }
+}
+
 /*
  * Renders the tree, that is rendering all outputs using render_con() and
  * pushing the changes to X11 using x_push_changes().
@@ -461,6 +490,7 @@ void tree_render(void) {
     render_con(croot);
 
     x_push_changes(croot);
+    mark_workspaces_clean();
     DLOG("-- END RENDERING --\n");
 }
 
@@ -16,6 +16,7 @@
  *
  */
 void window_free(i3Window *win) {
+    window_set_urgent(win, false);
     FREE(win->class_class);
     FREE(win->class_instance);
     FREE(win->role);
@@ -26,6 +27,58 @@ void window_free(i3Window *win) {
     FREE(win);
 }
 
+/* All urgent windows, ordered by the time they were marked urgent (oldest
+ * first). */
+static TAILQ_HEAD(urgent_windows_head, Window) urgent_windows = TAILQ_HEAD_INITIALIZER(urgent_windows);
+
+/*
+ * Marks the given window as urgent (now) or clears its urgency and updates
+ * the list of urgent windows accordingly.
+ *
+ */
+void window_set_urgent(i3Window *win, bool urgent) {
+    if (win->urgent.tv_sec != 0) {
+        TAILQ_REMOVE(&urgent_windows, win, urgent_windows);
+    }
+
+    if (!urgent) {
+        win->urgent.tv_sec = 0;
+        win->urgent.tv_usec = 0;
+        return;
+    }
+
+    gettimeofday(&win->urgent, NULL);
+
+    /* This is the newest urgent window unless the clock was set back. */
+    i3Window *prev = TAILQ_LAST(&urgent_windows, urgent_windows_head);
+    while (prev != NULL && _i3_timercmp(prev->urgent, win->urgent, >)) {
+        prev = TAILQ_PREV(prev, urgent_windows_head, urgent_windows);
+    }
+    if (prev == NULL) {
+        TAILQ_INSERT_HEAD(&urgent_windows, win, urgent_windows);
+    } else {
+        TAILQ_INSERT_AFTER(&urgent_windows, prev, win, urgent_windows);
+    }
+}
+
+/*
+ * Returns the window which was marked urgent most recently or NULL if no
+ * window is urgent.
+ *
+ */
+i3Window *window_latest_urgent(void) {
+    return TAILQ_LAST(&urgent_windows, urgent_windows_head);
+}
+
+/*
+ * Returns the window which was marked urgent first or NULL if no window is
+ * urgent.
+ *
+ */
+i3Window *window_oldest_urgent(void) {
+    return TAILQ_FIRST(&urgent_windows);
+}
+
 /*
  * Updates the WM_CLASS (consisting of the class and instance) for the
  * given window.
@@ -11,6 +11,8 @@
 #include "all.h"
 #include "yajl_utils.h"
 
+#include <ctype.h>
+
 /*
  * Stores a copy of the name of the last used workspace for the workspace
  * back-and-forth switching.
@@ -22,17 +24,189 @@ char *previous_workspace_name = NULL;
  * keybindings. */
 static char **binding_workspace_names = NULL;
 
+/* Index of all workspaces attached to an output's content container, so that
+ * looking up a workspace by name or number does not need to walk the tree.
+ * Names and numbers are not guaranteed to be unique (e.g. while restoring a
+ * layout), so each key stores a bucket with the number of workspaces using it.
+ * Lookups of ambiguous keys fall back to walking the tree, which keeps the
+ * "first in tree order" semantics. */
+struct workspace_bucket {
+    /* The only workspace with this key or NULL if it is not known (yet). */
+    Con *ws;
+    int count;
+};
+
+/* The key a workspace was indexed with. The name and number of a workspace
+ * may be changed before it is detached (see cmd_rename_workspace()), so the
+ * old keys have to be remembered. */
+struct workspace_keys {
+    char *name;
+    int num;
+};
+
+static struct hashmap workspaces_by_name;
+static struct hashmap workspaces_by_num;
+static struct hashmap workspace_keys;
+
+/* Sorted array of the distinct numbers (other than -1) of all indexed
+ * workspaces, used to find the next/previous numbered workspace. */
+static int *workspace_nums = NULL;
+static size_t workspace_nums_count = 0;
+static size_t workspace_nums_capacity = 0;
+
+/*
+ * Returns a copy of the given workspace name which can be used as a key for
+ * workspaces_by_name. Workspace names are compared using strcasecmp(), which
+ * compares the tolower() of each byte, so we do the same here.
+ *
+ */
+static char *workspace_name_key(const char *name) {
+    char *key = sstrdup(name);
+    for (char *walk = key; *walk != '\0'; walk++) {
+        *walk = tolower((unsigned char)*walk);
+    }
+    return key;
+}
+
+/*
+ * Returns the position of the first element of workspace_nums which is not
+ * smaller than num.
+ *
+ */
+static size_t workspace_nums_lower_bound(int num) {
+    size_t lo = 0, hi = workspace_nums_count;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (workspace_nums[mid] < num) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void workspace_bucket_add(struct workspace_bucket *bucket, Con *ws) {
+    bucket->ws = (bucket->count == 0 ? ws : NULL);
+    bucket->count++;
+}
+
+/*
+ * Removes the given workspace from the bucket and returns true if the bucket
+ * is now empty.
+ *
+ */
+static bool workspace_bucket_remove(struct workspace_bucket *bucket) {
+    bucket->count--;
+    /* If one workspace is left, it is looked up (and remembered) lazily. */
+    bucket->ws = NULL;
+    return (bucket->count == 0);
+}
+
+/*
+ * Adds the given workspace to the name/number index. Called by con_attach()
+ * for every workspace which is attached to a content container.
+ *
+ */
+void workspace_index_add(Con *ws) {
+    assert(ws->type == CT_WORKSPACE);
+    if (ws->name == NULL || hashmap_get(&workspace_keys, (uintptr_t)ws) != NULL) {
+        return;
+    }
+
+    struct workspace_keys *keys = smalloc(sizeof(struct workspace_keys));
+    keys->name = workspace_name_key(ws->name);
+    keys->num = ws->num;
+    hashmap_put(&workspace_keys, (uintptr_t)ws, keys);
+
+    struct workspace_bucket *bucket = hashmap_get_string(&workspaces_by_name, keys->name);
+    if (bucket == NULL) {
+        bucket = scalloc(1, sizeof(struct workspace_bucket));
+        hashmap_put_string(&workspaces_by_name, keys->name, bucket);
+    }
+    workspace_bucket_add(bucket, ws);
+
+    bucket = hashmap_get(&workspaces_by_num, (uint64_t)keys->num);
+    if (bucket == NULL) {
+        bucket = scalloc(1, sizeof(struct workspace_bucket));
+        hashmap_put(&workspaces_by_num, (uint64_t)keys->num, bucket);
+
+        if (keys->num != -1) {
+            if (workspace_nums_count == workspace_nums_capacity) {
+                workspace_nums_capacity = (workspace_nums_capacity == 0 ? 16 : workspace_nums_capacity * 2);
+                workspace_nums = srealloc(workspace_nums, workspace_nums_capacity * sizeof(int));
+            }
+            const size_t pos = workspace_nums_lower_bound(keys->num);
+            memmove(workspace_nums + pos + 1, workspace_nums + pos,
+                    (workspace_nums_count - pos) * sizeof(int));
+            workspace_nums[pos] = keys->num;
+            workspace_nums_count++;
+        }
+    }
+    workspace_bucket_add(bucket, ws);
+}
+
+/*
+ * Removes the given workspace from the name/number index. Called by
+ * con_detach() for workspaces.
+ *
+ */
+void workspace_index_remove(Con *ws) {
+    struct workspace_keys *keys = hashmap_remove(&workspace_keys, (uintptr_t)ws);
+    if (keys == NULL) {
+        return;
+    }
+
+    struct workspace_bucket *bucket = hashmap_get_string(&workspaces_by_name, keys->name);
+    assert(bucket != NULL);
+    if (workspace_bucket_remove(bucket)) {
+        hashmap_remove_string(&workspaces_by_name, keys->name);
+        free(bucket);
+    }
+
+    bucket = hashmap_get(&workspaces_by_num, (uint64_t)keys->num);
+    assert(bucket != NULL);
+    if (workspace_bucket_remove(bucket)) {
+        hashmap_remove(&workspaces_by_num, (uint64_t)keys->num);
+        free(bucket);
+
+        if (keys->num != -1) {
+            const size_t pos = workspace_nums_lower_bound(keys->num);
+            assert(pos < workspace_nums_count && workspace_nums[pos] == keys->num);
+            memmove(workspace_nums + pos, workspace_nums + pos + 1,
+                    (workspace_nums_count - pos - 1) * sizeof(int));
+            workspace_nums_count--;
+        }
+    }
+
+    free(keys->name);
+    free(keys);
+}
+
 /*
  * Returns the workspace with the given name or NULL if such a workspace does
  * not exist.
  *
  */
 Con *get_existing_workspace_by_name(const char *name) {
+    char *key = workspace_name_key(name);
+    struct workspace_bucket *bucket = hashmap_get_string(&workspaces_by_name, key);
+    free(key);
+    if (bucket == NULL) {
+        return NULL;
+    }
+    if (bucket->ws != NULL) {
+        return bucket->ws;
+    }
+
     Con *output, *workspace = NULL;
     TAILQ_FOREACH (output, &(croot->nodes_head), nodes) {
         GREP_FIRST(workspace, output_get_content(output), !strcasecmp(child->name, name));
     }
 
+    if (bucket->count == 1) {
+        bucket->ws = workspace;
+    }
     return workspace;
 }
 
@@ -42,14 +216,39 @@ Con *get_existing_workspace_by_name(const char *name) {
  *
  */
 Con *get_existing_workspace_by_num(int num) {
+    struct workspace_bucket *bucket = hashmap_get(&workspaces_by_num, (uint64_t)num);
+    if (bucket == NULL) {
+        return NULL;
+    }
+    if (bucket->ws != NULL) {
+        return bucket->ws;
+    }
+
     Con *output, *workspace = NULL;
     TAILQ_FOREACH (output, &(croot->nodes_head), nodes) {
         GREP_FIRST(workspace, output_get_content(output), child->num == num);
     }
 
+    if (bucket->count == 1) {
+        bucket->ws = workspace;
+    }
     return workspace;
 }
 
+/*
+ * Returns the only workspace using the given number, or NULL if there is none
+ * or more than one (in which case the tree has to be walked to find the right
+ * one).
+ *
+ */
+static Con *workspace_unique_by_num(int num) {
+    struct workspace_bucket *bucket = hashmap_get(&workspaces_by_num, (uint64_t)num);
+    if (bucket == NULL || bucket->count != 1) {
+        return NULL;
+    }
+    return get_existing_workspace_by_num(num);
+}
+
 /*
  * Sets ws->layout to splith/splitv if default_orientation was specified in the
  * configfile. Otherwise, it uses splith/splitv depending on whether the output
@@ -384,9 +583,10 @@ static void workspace_reassign_sticky(Con *con) {
         }
 
         x_move_win(src, current);
-        current->window = src->window;
+        i3Window *window = src->window;
+        con_set_window(src, NULL);
+        con_set_window(current, window);
         current->mapped = true;
-        src->window = NULL;
         src->mapped = false;
 
         x_reparent_child(current, src);
@@ -524,7 +724,7 @@ void workspace_show(Con *workspace) {
             const unsigned char *payload;
             ylength length;
             y(get_buf, &payload, &length);
-            ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, (const char *)payload);
+            ipc_send_event(I3_IPC_EVENT_WORKSPACE, (const char *)payload);
 
             y(free);
 
@@ -596,6 +796,11 @@ Con *workspace_next(void) {
         }
     } else {
         /* If currently a numbered workspace, find next numbered workspace. */
+        const size_t pos = workspace_nums_lower_bound(current->num + 1);
+        if (pos < workspace_nums_count &&
+            (next = workspace_unique_by_num(workspace_nums[pos])) != NULL) {
+            return next;
+        }
         TAILQ_FOREACH (output, &(croot->nodes_head), nodes) {
             /* Skip outputs starting with __, they are internal. */
             if (con_is_internal(output))
@@ -662,6 +867,10 @@ Con *workspace_prev(void) {
         }
     } else {
         /* If numbered workspace, find previous numbered workspace. */
+        const size_t pos = workspace_nums_lower_bound(current->num);
+        if (pos > 0 && (prev = workspace_unique_by_num(workspace_nums[pos - 1])) != NULL) {
+            return prev;
+        }
         TAILQ_FOREACH_REVERSE (output, &(croot->nodes_head), nodes_head, nodes) {
             /* Skip outputs starting with __, they are internal. */
             if (con_is_internal(output))
@@ -8,6 +8,7 @@
  *      render.c). Basically a big state machine.
  *
  */
+#define I3_LOG_CATEGORY LOG_CATEGORY_RENDER
 #include "all.h"
 
 #include <unistd.h>
@@ -27,6 +28,12 @@ static xcb_window_t last_focused = XCB_NONE;
 /* Stores coordinates to warp mouse pointer to if set */
 static Rect *warp_to;
 
+/* The last value assigned to a frame_buffer_generation. The values are never
+ * reused, so a child which moved to another parent always sees a different
+ * generation than the one of the frame_buffer it last copied its title bar
+ * into. */
+static uint32_t last_frame_buffer_generation = 0;
+
 /*
  * Describes the X11 state we may modify (map state, position, window stack).
  * There is one entry per container. The state represents the current situation
@@ -59,8 +66,14 @@ typedef struct con_state {
     Rect rect;
     Rect window_rect;
 
+    /* The event mask which was last set on the frame. */
+    uint32_t event_mask;
+
     bool initial;
 
+    /* Position (from the bottom) in old_state_head, see x_push_stack(). */
+    int old_index;
+
     char *name;
 
     CIRCLEQ_ENTRY(con_state) state;
@@ -77,6 +90,15 @@ CIRCLEQ_HEAD(old_state_head, con_state) old_state_head =
 TAILQ_HEAD(initial_mapping_head, con_state) initial_mapping_head =
     TAILQ_HEAD_INITIALIZER(initial_mapping_head);
 
+/* Maps frame IDs to their con_state. Looking up the state of a frame happens
+ * for every container in every x_push_changes() run, so walking state_head
+ * for each lookup would make pushing the state quadratic. */
+static struct hashmap states_by_frame;
+
+/* Number of event mask changes sent by the current x_push_changes() run (for
+ * debugging). */
+static unsigned int event_mask_requests;
+
 /*
  * Returns the container state for the given frame. This function always
  * returns a container state (otherwise, there is a bug in the code and the
@@ -85,11 +107,9 @@ TAILQ_HEAD(initial_mapping_head, con_state) initial_mapping_head =
  *
  */
 static con_state *state_for_frame(xcb_window_t window) {
-    con_state *state;
-    CIRCLEQ_FOREACH (state, &state_head, state) {
-        if (state->id == window) {
-            return state;
-        }
+    con_state *state = hashmap_get(&states_by_frame, window);
+    if (state != NULL) {
+        return state;
     }
 
     /* TODO: better error handling? */
@@ -98,6 +118,20 @@ static con_state *state_for_frame(xcb_window_t window) {
     return NULL;
 }
 
+/*
+ * Sets the event mask of the given frame, unless the frame already has it.
+ *
+ */
+static void x_set_frame_event_mask(con_state *state, uint32_t mask) {
+    if (state->event_mask == mask) {
+        return;
+    }
+
+    xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, (uint32_t[]){mask});
+    state->event_mask = mask;
+    event_mask_requests++;
+}
+
 /*
  * Changes the atoms on the root window and the windows themselves to properly
  * reflect the current focus for ewmh compliance.
@@ -168,6 +202,7 @@ void x_con_init(Con *con) {
     Rect dims = {-15, -15, 10, 10};
     xcb_window_t frame_id = create_window(conn, dims, con->depth, visual, XCB_WINDOW_CLASS_INPUT_OUTPUT, XCURSOR_CURSOR_POINTER, false, mask, values);
     draw_util_surface_init(conn, &(con->frame), frame_id, get_visualtype_by_id(visual), dims.width, dims.height);
+    con_index_frame(con);
     xcb_change_property(conn,
                         XCB_PROP_MODE_REPLACE,
                         con->frame.id,
@@ -177,14 +212,18 @@ void x_con_init(Con *con) {
                         (strlen("i3-frame") + 1) * 2,
                         "i3-frame\0i3-frame\0");
 
+    con_mark_dirty(con);
+
     struct con_state *state = scalloc(1, sizeof(struct con_state));
     state->id = con->frame.id;
     state->mapped = false;
     state->initial = true;
+    state->event_mask = values[3];
     DLOG("Adding window 0x%08x to lists\n", state->id);
     CIRCLEQ_INSERT_HEAD(&state_head, state, state);
     CIRCLEQ_INSERT_HEAD(&old_state_head, state, old_state);
     TAILQ_INSERT_TAIL(&initial_mapping_head, state, initial_mapping_order);
+    hashmap_put(&states_by_frame, state->id, state);
     DLOG("adding new state for window id 0x%08x\n", state->id);
 }
 
@@ -202,6 +241,7 @@ void x_reinit(Con *con) {
         return;
     }
 
+    con_mark_dirty(con);
     DLOG("resetting state %p to initial\n", state);
     state->initial = true;
     state->child_mapped = false;
@@ -223,6 +263,7 @@ void x_reparent_child(Con *con, Con *old) {
 
     state->need_reparent = true;
     state->old_frame = old->frame.id;
+    con_mark_dirty(con);
 }
 
 /*
@@ -244,6 +285,8 @@ void x_move_win(Con *src, Con *dest) {
 
     state_dest->con = state_src->con;
     state_src->con = NULL;
+    con_mark_dirty(src);
+    con_mark_dirty(dest);
 
     if (rect_equals(state_dest->window_rect, (Rect){0, 0, 0, 0})) {
         memcpy(&(state_dest->window_rect), &(state_src->window_rect), sizeof(Rect));
@@ -251,6 +294,45 @@ void x_move_win(Con *src, Con *dest) {
     }
 }
 
+/*
+ * Frees the pixmap into which the title bar of the given container is
+ * rendered, if any.
+ *
+ */
+static void x_free_deco_buffer(Con *con) {
+    if (con->deco_buffer.id == XCB_NONE) {
+        return;
+    }
+    draw_util_surface_free(conn, &(con->deco_buffer));
+    xcb_free_pixmap(conn, con->deco_buffer.id);
+    con->deco_buffer.id = XCB_NONE;
+}
+
+/*
+ * Makes sure the given container has a pixmap of the size of its decoration
+ * into which its title bar can be rendered. The pixmap has the depth of the
+ * parent's frame_buffer, into which it is copied.
+ *
+ */
+static void x_ensure_deco_buffer(Con *con) {
+    const int width = MAX((int32_t)con->deco_rect.width, 1);
+    const int height = MAX((int32_t)con->deco_rect.height, 1);
+
+    if (con->deco_buffer.id != XCB_NONE &&
+        con->deco_buffer.width == width &&
+        con->deco_buffer.height == height) {
+        return;
+    }
+
+    x_free_deco_buffer(con);
+
+    con->deco_buffer.id = xcb_generate_id(conn);
+    xcb_create_pixmap(conn, root_depth, con->deco_buffer.id, con->parent->frame.id, width, height);
+    draw_util_surface_init(conn, &(con->deco_buffer), con->deco_buffer.id,
+                           get_visualtype_by_id(get_visualid_by_depth(root_depth)), width, height);
+    xcb_change_gc(conn, con->deco_buffer.gc, XCB_GC_GRAPHICS_EXPOSURES, (uint32_t[]){0});
+}
+
 static void _x_con_kill(Con *con) {
     con_state *state;
 
@@ -262,10 +344,13 @@ static void _x_con_kill(Con *con) {
     draw_util_surface_free(conn, &(con->frame_buffer));
     xcb_free_pixmap(conn, con->frame_buffer.id);
     con->frame_buffer.id = XCB_NONE;
+    x_free_deco_buffer(con);
+    con_unindex_frame(con);
     state = state_for_frame(con->frame.id);
     CIRCLEQ_REMOVE(&state_head, state, state);
     CIRCLEQ_REMOVE(&old_state_head, state, old_state);
     TAILQ_REMOVE(&initial_mapping_head, state, initial_mapping_order);
+    hashmap_remove(&states_by_frame, state->id);
     FREE(state->name);
     free(state);
 
@@ -355,9 +440,7 @@ void x_window_kill(xcb_window_t window, kill_window_t kill_window) {
     free(event);
 }
 
-static void x_draw_title_border(Con *con, struct deco_render_params *p, surface_t *dest_surface) {
-    Rect *dr = &(con->deco_rect);
-
+static void x_draw_title_border(Rect *dr, struct deco_render_params *p, surface_t *dest_surface) {
     /* Left */
     draw_util_rectangle(dest_surface, p->color->border,
                         dr->x, dr->y, 1, dr->height);
@@ -375,11 +458,7 @@ static void x_draw_title_border(Con *con, struct deco_render_params *p, surface_
                         dr->x, dr->y + dr->height - 1, dr->width, 1);
 }
 
-static void x_draw_decoration_after_title(Con *con, struct deco_render_params *p, surface_t *dest_surface) {
-    assert(con->parent != NULL);
-
-    Rect *dr = &(con->deco_rect);
-
+static void x_draw_decoration_after_title(Rect *dr, struct deco_render_params *p, surface_t *dest_surface) {
     /* Redraw the right border to cut off any text that went past it.
      * This is necessary when the text was drawn using XCB since cutting text off
      * automatically does not work there. For pango rendering, this isn't necessary. */
@@ -395,7 +474,7 @@ static void x_draw_decoration_after_title(Con *con, struct deco_render_params *p
     }
 
     /* Redraw the border. */
-    x_draw_title_border(con, p, dest_surface);
+    x_draw_title_border(dr, p, dest_surface);
 }
 
 /*
@@ -514,19 +593,39 @@ void x_draw_decoration(Con *con) {
     p->con_is_leaf = con_is_leaf(con);
     p->parent_layout = con->parent->layout;
 
+    /* Title bars of children of stacked/tabbed containers are drawn into
+     * their own pixmap and then copied into the parent's pixmap. */
+    const bool use_deco_buffer = (p->border_style == BS_NORMAL && !con_draw_decoration_into_frame(con));
+
     if (con->deco_render_params != NULL &&
         (con->window == NULL || !con->window->name_x_changed) &&
-        !parent->pixmap_recreated &&
         !con->pixmap_recreated &&
         !con->mark_changed &&
         memcmp(p, con->deco_render_params, sizeof(struct deco_render_params)) == 0) {
-        free(p);
-        goto copy_pixmaps;
+        if (use_deco_buffer && con->deco_buffer.id != XCB_NONE) {
+            free(p);
+            /* The title bar did not change, but it still needs to be copied
+             * if the parent's pixmap was recreated in the meantime. */
+            if (con->deco_buffer_generation != parent->frame_buffer_generation) {
+                goto copy_deco_buffer;
+            }
+            goto copy_pixmaps;
+        }
+        if (!parent->pixmap_recreated) {
+            free(p);
+            goto copy_pixmaps;
+        }
     }
 
-    Con *next = con;
-    while ((next = TAILQ_NEXT(next, nodes))) {
-        FREE(next->deco_render_params);
+    /* Text drawn with X core fonts is not cut off at the end of the title
+     * bar, so the title bars of the following siblings need to be drawn
+     * again. Title bars rendered into their own pixmap are cut off by it. */
+    if (!use_deco_buffer) {
+        Con *next = con;
+        while ((next = TAILQ_NEXT(next, nodes))) {
+            FREE(next->deco_render_params);
+        }
+        x_free_deco_buffer(con);
     }
 
     FREE(con->deco_render_params);
@@ -602,8 +701,12 @@ void x_draw_decoration(Con *con) {
 
     /* If the parent hasn't been set up yet, skip the decoration rendering
      * for now. */
-    if (dest_surface->id == XCB_NONE)
+    if (dest_surface->id == XCB_NONE) {
+        /* Make sure the title bar is rendered once the parent's pixmap is
+         * created. */
+        FREE(con->deco_render_params);
         goto copy_pixmaps;
+    }
 
     /* For the first child, we clear the parent pixmap to ensure there's no
      * garbage left on there. This is important to avoid tearing when using
@@ -617,21 +720,30 @@ void x_draw_decoration(Con *con) {
     if (p->border_style != BS_NORMAL)
         goto copy_pixmaps;
 
+    /* The rectangle of the title bar within dest_surface */
+    Rect dr = con->deco_rect;
+    if (use_deco_buffer) {
+        x_ensure_deco_buffer(con);
+        dest_surface = &(con->deco_buffer);
+        dr.x = 0;
+        dr.y = 0;
+    }
+
     /* 4: paint the bar */
     DLOG("con->deco_rect = (x=%d, y=%d, w=%d, h=%d) for con->name=%s\n",
          con->deco_rect.x, con->deco_rect.y, con->deco_rect.width, con->deco_rect.height, con->name);
     draw_util_rectangle(dest_surface, p->color->background,
-                        con->deco_rect.x, con->deco_rect.y, con->deco_rect.width, con->deco_rect.height);
+                        dr.x, dr.y, dr.width, dr.height);
 
     /* 5: draw title border */
-    x_draw_title_border(con, p, dest_surface);
+    x_draw_title_border(&dr, p, dest_surface);
 
     /* 6: draw the icon and title */
-    int text_offset_y = (con->deco_rect.height - config.font.height) / 2;
+    int text_offset_y = (dr.height - config.font.height) / 2;
 
     struct Window *win = con->window;
 
-    const int deco_width = (int)con->deco_rect.width;
+    const int deco_width = (int)dr.width;
     const int title_padding = logical_px(2);
 
     int mark_width = 0;
@@ -661,8 +773,8 @@ void x_draw_decoration(Con *con) {
 
             draw_util_text(mark, dest_surface,
                            p->color->text, p->color->background,
-                           con->deco_rect.x + mark_offset_x,
-                           con->deco_rect.y + text_offset_y, mark_width);
+                           dr.x + mark_offset_x,
+                           dr.y + text_offset_y, mark_width);
             I3STRING_FREE(mark);
 
             mark_width += title_padding;
@@ -688,12 +800,12 @@ void x_draw_decoration(Con *con) {
         title = con->title_format == NULL ? win->name : con_parse_title_format(con);
     }
     if (title == NULL) {
-        goto copy_pixmaps;
+        goto copy_deco_buffer;
     }
 
     /* icon_padding is applied horizontally only, the icon will always use all
      * available vertical space. */
-    int icon_size = max(0, con->deco_rect.height - logical_px(2));
+    int icon_size = max(0, dr.height - logical_px(2));
     int icon_padding = logical_px(max(1, con->window_icon_padding));
     int total_icon_space = icon_size + 2 * icon_padding;
     const bool has_icon = (con->window_icon_padding > -1) && win && win->icon && (total_icon_space < deco_width);
@@ -738,15 +850,15 @@ void x_draw_decoration(Con *con) {
 
     draw_util_text(title, dest_surface,
                    p->color->text, p->color->background,
-                   con->deco_rect.x + title_offset_x,
-                   con->deco_rect.y + text_offset_y,
+                   dr.x + title_offset_x,
+                   dr.y + text_offset_y,
                    deco_width - mark_width - 2 * title_padding - total_icon_space);
     if (has_icon) {
         draw_util_image(
             win->icon,
             dest_surface,
-            con->deco_rect.x + icon_offset_x,
-            con->deco_rect.y + logical_px(1),
+            dr.x + icon_offset_x,
+            dr.y + logical_px(1),
             icon_size,
             icon_size);
     }
@@ -755,7 +867,14 @@ void x_draw_decoration(Con *con) {
         I3STRING_FREE(title);
     }
 
-    x_draw_decoration_after_title(con, p, dest_surface);
+    x_draw_decoration_after_title(&dr, p, dest_surface);
+copy_deco_buffer:
+    /* The parent may not have a pixmap yet (see above). */
+    if (use_deco_buffer && parent->frame_buffer.id != XCB_NONE) {
+        draw_util_copy_surface(&(con->deco_buffer), &(parent->frame_buffer), 0, 0,
+                               con->deco_rect.x, con->deco_rect.y, con->deco_rect.width, con->deco_rect.height);
+        con->deco_buffer_generation = parent->frame_buffer_generation;
+    }
 copy_pixmaps:
     draw_util_copy_surface(&(con->frame_buffer), &(con->frame), 0, 0, 0, 0, con->rect.width, con->rect.height);
 }
@@ -767,6 +886,10 @@ copy_pixmaps:
  *
  */
 void x_deco_recurse(Con *con) {
+    if (con_is_render_clean(con)) {
+        return;
+    }
+
     Con *current;
     bool leaf = TAILQ_EMPTY(&(con->nodes_head)) &&
                 TAILQ_EMPTY(&(con->floating_head));
@@ -882,30 +1005,21 @@ static void set_shape_state(Con *con, bool need_reshape) {
 }
 
 /*
- * This function pushes the properties of each node of the layout tree to
- * X11 if they have changed (like the map state, position of the window, …).
- * It recursively traverses all children of the given node.
+ * Returns the rect the frame of the given container gets in X11. Sets
+ * *can_map to false if the frame must not be mapped: containers without a
+ * window only need a frame when they are stacked or tabbed (it holds the
+ * decorations of their children).
  *
  */
-void x_push_node(Con *con) {
-    Con *current;
-    con_state *state;
+static Rect x_frame_rect(Con *con, bool *can_map) {
     Rect rect = con->rect;
-
-    state = state_for_frame(con->frame.id);
-
-    if (state->name != NULL) {
-        DLOG("pushing name %s for con %p\n", state->name, con);
-
-        xcb_change_property(conn, XCB_PROP_MODE_REPLACE, con->frame.id,
-                            XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, strlen(state->name), state->name);
-        FREE(state->name);
-    }
+    *can_map = true;
 
     if (con->window == NULL && (con->layout == L_STACKED || con->layout == L_TABBED)) {
         /* Calculate the height of all window decorations which will be drawn on to
          * this frame. */
         uint32_t max_y = 0, max_height = 0;
+        Con *current;
         TAILQ_FOREACH (current, &(con->nodes_head), nodes) {
             Rect *dr = &(current->deco_rect);
             if (dr->y >= max_y && dr->height >= max_height) {
@@ -915,11 +1029,77 @@ void x_push_node(Con *con) {
         }
         rect.height = max_y + max_height;
         if (rect.height == 0)
-            con->mapped = false;
+            *can_map = false;
     } else if (con->window == NULL) {
         /* not a stacked or tabbed split container */
-        con->mapped = false;
+        *can_map = false;
+    }
+
+    return rect;
+}
+
+/*
+ * Returns true if x_push_node() would map, unmap, move, resize or reparent
+ * any window of the given container or its children. Only then, frames can
+ * get EnterNotify events which x_push_changes() needs to suppress.
+ *
+ */
+static bool x_push_node_pending(Con *con) {
+    if (con_is_render_clean(con)) {
+        return false;
+    }
+
+    con_state *state = state_for_frame(con->frame.id);
+    bool can_map;
+    Rect rect = x_frame_rect(con, &can_map);
+    bool mapped = con->mapped && can_map;
+
+    if (state->need_reparent ||
+        state->mapped != mapped ||
+        (mapped && con->window != NULL && !state->child_mapped) ||
+        (!rect_equals(state->rect, rect) && rect.height > 0) ||
+        (con->window != NULL && !rect_equals(state->window_rect, con->window_rect))) {
+        return true;
+    }
+
+    Con *current;
+    TAILQ_FOREACH (current, &(con->focus_head), focused) {
+        if (x_push_node_pending(current)) {
+            return true;
+        }
     }
+    return false;
+}
+
+/*
+ * This function pushes the properties of each node of the layout tree to
+ * X11 if they have changed (like the map state, position of the window, …).
+ * It recursively traverses all children of the given node.
+ *
+ */
+void x_push_node(Con *con) {
+    Con *current;
+    con_state *state;
+
+    /* Nothing changed on invisible workspaces since they were unmapped. */
+    if (con_is_render_clean(con)) {
+        return;
+    }
+
+    state = state_for_frame(con->frame.id);
+
+    if (state->name != NULL) {
+        DLOG("pushing name %s for con %p\n", state->name, con);
+
+        xcb_change_property(conn, XCB_PROP_MODE_REPLACE, con->frame.id,
+                            XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, strlen(state->name), state->name);
+        FREE(state->name);
+    }
+
+    bool can_map;
+    Rect rect = x_frame_rect(con, &can_map);
+    if (!can_map)
+        con->mapped = false;
 
     bool need_reshape = false;
 
@@ -942,6 +1122,11 @@ void x_push_node(Con *con) {
         values[0] = CHILD_EVENT_MASK;
         xcb_change_window_attributes(conn, con->window->id, XCB_CW_EVENT_MASK, values);
 
+        con_state *old_frame_state = hashmap_get(&states_by_frame, state->old_frame);
+        if (old_frame_state != NULL) {
+            old_frame_state->event_mask = FRAME_EVENT_MASK;
+        }
+
         state->old_frame = XCB_NONE;
         state->need_reparent = false;
 
@@ -1029,6 +1214,7 @@ void x_push_node(Con *con) {
 
             draw_util_surface_set_size(&(con->frame), width, height);
             con->pixmap_recreated = true;
+            con->frame_buffer_generation = ++last_frame_buffer_generation;
 
             /* Don’t render the decoration for windows inside a stack which are
              * not visible right now
@@ -1099,8 +1285,7 @@ void x_push_node(Con *con) {
 
         cookie = xcb_map_window(conn, con->frame.id);
 
-        values[0] = FRAME_EVENT_MASK;
-        xcb_change_window_attributes(conn, con->frame.id, XCB_CW_EVENT_MASK, values);
+        x_set_frame_event_mask(state, FRAME_EVENT_MASK);
 
         /* copy the pixmap contents to the frame window immediately after mapping */
         if (con->frame_buffer.id != XCB_NONE) {
@@ -1143,6 +1328,10 @@ static void x_push_node_unmaps(Con *con) {
     Con *current;
     con_state *state;
 
+    if (con_is_render_clean(con)) {
+        return;
+    }
+
     state = state_for_frame(con->frame.id);
 
     /* map/unmap if map state changed, also ensure that the child window
@@ -1197,6 +1386,98 @@ static bool is_con_attached(Con *con) {
     return false;
 }
 
+/*
+ * Restacks the given frames (ordered from bottom to top) in X11, which
+ * currently stacks them in the order of old_state_head.
+ *
+ * Instead of restacking every frame above the first one whose predecessor
+ * changed, we only move the frames which are not part of a longest increasing
+ * subsequence of old positions: the frames in that subsequence already have
+ * the correct relative order. Raising a single window thus results in a single
+ * ConfigureWindow request. Returns true if any frame was restacked.
+ *
+ */
+static bool x_push_stack(con_state **stack, int n) {
+    static int *lis_tails = NULL;
+    static int *lis_prev = NULL;
+    static bool *keep = NULL;
+    static int allocated = 0;
+
+    if (n > allocated) {
+        lis_tails = srealloc(lis_tails, sizeof(int) * n);
+        lis_prev = srealloc(lis_prev, sizeof(int) * n);
+        keep = srealloc(keep, sizeof(bool) * n);
+        allocated = n;
+    }
+
+    con_state *state;
+    int old_index = 0;
+    CIRCLEQ_FOREACH_REVERSE (state, &old_state_head, old_state) {
+        state->old_index = old_index++;
+    }
+
+    /* Frames which were never stacked (initial) always need to be moved. */
+    int len = 0;
+    for (int i = 0; i < n; i++) {
+        keep[i] = false;
+        if (stack[i]->initial) {
+            continue;
+        }
+
+        int lo = 0, hi = len;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (stack[lis_tails[mid]]->old_index < stack[i]->old_index) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        lis_prev[i] = (lo > 0 ? lis_tails[lo - 1] : -1);
+        lis_tails[lo] = i;
+        if (lo == len) {
+            len++;
+        }
+    }
+    for (int i = (len > 0 ? lis_tails[len - 1] : -1); i != -1; i = lis_prev[i]) {
+        keep[i] = true;
+    }
+
+    /* The lowest frame which stays in place is the anchor. If all frames need
+     * to be moved, the bottom-most one is used. */
+    int anchor = 0;
+    while (anchor < n && !keep[anchor]) {
+        anchor++;
+    }
+    if (anchor == n) {
+        anchor = 0;
+    }
+
+    const uint32_t mask = XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE;
+    int moved = 0;
+
+    /* Frames below the anchor are stacked downwards from it… */
+    for (int i = anchor - 1; i >= 0; i--) {
+        uint32_t values[] = {stack[i + 1]->id, XCB_STACK_MODE_BELOW};
+        xcb_configure_window(conn, stack[i]->id, mask, values);
+        moved++;
+    }
+
+    /* …and misplaced frames above it go right above their new predecessor,
+     * which is already at its final position at that point. */
+    for (int i = anchor + 1; i < n; i++) {
+        if (keep[i]) {
+            continue;
+        }
+        uint32_t values[] = {stack[i - 1]->id, XCB_STACK_MODE_ABOVE};
+        xcb_configure_window(conn, stack[i]->id, mask, values);
+        moved++;
+    }
+
+    DLOG("Restacked %d of %d frames\n", moved, n);
+    return (moved > 0);
+}
+
 /*
  * Pushes all changes (state of each node, see x_push_node() and the window
  * stack) to X11.
@@ -1218,24 +1499,19 @@ void x_push_changes(Con *con) {
     }
 
     DLOG("-- PUSHING WINDOW STACK --\n");
-    /* We need to keep SubstructureRedirect around, otherwise clients can send
-     * ConfigureWindow requests and get them applied directly instead of having
-     * them become ConfigureRequests that i3 handles. */
-    uint32_t values[1] = {XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT};
-    CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
-        if (state->mapped)
-            xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
-    }
+    event_mask_requests = 0;
     bool order_changed = false;
     bool stacking_changed = false;
 
     /* count first, necessary to (re)allocate memory for the bottom-to-top
      * stack afterwards */
     int cnt = 0;
+    int states_cnt = 0;
     CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
         if (con_has_managed_window(state->con)) {
             cnt++;
         }
+        states_cnt++;
     }
 
     /* The bottom-to-top window stack of all windows which are managed by i3.
@@ -1243,37 +1519,60 @@ void x_push_changes(Con *con) {
     static xcb_window_t *client_list_windows = NULL;
     static int client_list_count = 0;
 
-    if (cnt != client_list_count) {
+    const bool client_list_changed = (cnt != client_list_count);
+    if (client_list_changed) {
         client_list_windows = srealloc(client_list_windows, sizeof(xcb_window_t) * cnt);
         client_list_count = cnt;
     }
 
+    /* The bottom-to-top stack of all frames, see x_push_stack(). */
+    static con_state **stack = NULL;
+    static int stack_size = 0;
+
+    if (states_cnt > stack_size) {
+        stack = srealloc(stack, sizeof(con_state *) * states_cnt);
+        stack_size = states_cnt;
+    }
+
     xcb_window_t *walk = client_list_windows;
+    con_state **stack_walk = stack;
 
     /* X11 correctly represents the stack if we push it from bottom to top */
     CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
         if (con_has_managed_window(state->con))
             memcpy(walk++, &(state->con->window->id), sizeof(xcb_window_t));
 
-        con_state *prev = CIRCLEQ_PREV(state, state);
-        con_state *old_prev = CIRCLEQ_PREV(state, old_state);
-        if (prev != old_prev)
+        if (state->initial || CIRCLEQ_PREV(state, state) != CIRCLEQ_PREV(state, old_state))
             order_changed = true;
-        if ((state->initial || order_changed) && prev != CIRCLEQ_END(&state_head)) {
-            stacking_changed = true;
-            uint32_t mask = 0;
-            mask |= XCB_CONFIG_WINDOW_SIBLING;
-            mask |= XCB_CONFIG_WINDOW_STACK_MODE;
-            uint32_t values[] = {state->id, XCB_STACK_MODE_ABOVE};
-
-            xcb_configure_window(conn, prev->id, mask, values);
+        *stack_walk++ = state;
+    }
+
+    /* While restacking, mapping and moving windows, frames must not get
+     * EnterNotify events (they would change focus). We need to keep
+     * SubstructureRedirect around, otherwise clients can send ConfigureWindow
+     * requests and get them applied directly instead of having them become
+     * ConfigureRequests that i3 handles. Warping the pointer can also put it
+     * over a different window. When nothing will be restacked, mapped or
+     * moved and the pointer is not warped, the event masks are left alone. */
+    if (order_changed || warp_to != NULL || x_push_node_pending(con)) {
+        CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
+            if (state->mapped)
+                x_set_frame_event_mask(state, XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT);
         }
+    }
+
+    if (order_changed) {
+        stacking_changed = x_push_stack(stack, states_cnt);
+    }
+
+    CIRCLEQ_FOREACH (state, &state_head, state) {
         state->initial = false;
     }
 
-    /* If we re-stacked something (or a new window appeared), we need to update
-     * the _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING hints */
-    if (stacking_changed) {
+    /* If we re-stacked something (or a window appeared or disappeared), we need
+     * to update the _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING hints. The
+     * ewmh functions only touch the properties if their contents changed. */
+    if (stacking_changed || client_list_changed) {
         DLOG("Client list changed (%i clients)\n", cnt);
         ewmh_update_client_list_stacking(client_list_windows, client_list_count);
 
@@ -1313,10 +1612,9 @@ void x_push_changes(Con *con) {
         warp_to = NULL;
     }
 
-    values[0] = FRAME_EVENT_MASK;
     CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
         if (state->mapped)
-            xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
+            x_set_frame_event_mask(state, FRAME_EVENT_MASK);
     }
 
     x_deco_recurse(con);
@@ -1347,6 +1645,7 @@ void x_push_changes(Con *con) {
                 /* We remove XCB_EVENT_MASK_FOCUS_CHANGE from the event mask to get
                  * no focus change events for our own focus changes. We only want
                  * these generated by the clients. */
+                uint32_t values[1];
                 if (focused->window != NULL) {
                     values[0] = CHILD_EVENT_MASK & ~(XCB_EVENT_MASK_FOCUS_CHANGE);
                     xcb_change_window_attributes(conn, focused->window->id, XCB_CW_EVENT_MASK, values);
@@ -1388,11 +1687,10 @@ void x_push_changes(Con *con) {
      * stack with two windows. If the first window is focused and gets
      * unmapped, the second one appears under the cursor and therefore gets an
      * EnterNotify event. */
-    values[0] = FRAME_EVENT_MASK & ~XCB_EVENT_MASK_ENTER_WINDOW;
     CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
         if (!state->unmap_now)
             continue;
-        xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
+        x_set_frame_event_mask(state, FRAME_EVENT_MASK & ~XCB_EVENT_MASK_ENTER_WINDOW);
     }
 
     /* Push all pending unmaps */
@@ -1404,6 +1702,8 @@ void x_push_changes(Con *con) {
         CIRCLEQ_INSERT_TAIL(&old_state_head, state, old_state);
     }
 
+    DLOG("Sent %u event mask requests for %d frames\n", event_mask_requests, states_cnt);
+
     xcb_flush(conn);
 }
 
@@ -1436,6 +1736,7 @@ void x_set_name(Con *con, const char *name) {
 
     FREE(state->name);
     state->name = sstrdup(name);
+    con_mark_dirty(con);
 }
 
 /*
@@ -1486,12 +1787,10 @@ void x_set_warp_to(Rect *rect) {
  *
  */
 void x_mask_event_mask(uint32_t mask) {
-    uint32_t values[] = {FRAME_EVENT_MASK & mask};
-
     con_state *state;
     CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
         if (state->mapped)
-            xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
+            x_set_frame_event_mask(state, FRAME_EVENT_MASK & mask);
     }
 }
 
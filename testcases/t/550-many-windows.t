@@ -0,0 +1,55 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that i3 manages, renders and closes a large number of windows
+# correctly. The container state of each frame is looked up in a hash table
+# (and no longer by walking all states), so this exercises inserting into,
+# looking up in and removing from that table while it grows and shrinks.
+use i3test;
+
+my $count = 1000;
+
+my $tmp = fresh_workspace;
+cmd 'layout tabbed';
+
+my @windows = map { open_window(dont_map => 1) } (1 .. $count);
+$_->map for @windows;
+sync_with_i3;
+
+is(scalar @{get_ws_content($tmp)}, $count, "all $count windows managed");
+
+cmd '[id="' . $windows[0]->id . '"] focus';
+is($x->input_focus, $windows[0]->id, 'first window focused');
+
+cmd '[id="' . $windows[-1]->id . '"] focus';
+is($x->input_focus, $windows[-1]->id, 'last window focused');
+
+# Close every second window to shrink the table with interleaved removals.
+for my $idx (grep { $_ % 2 == 0 } (0 .. $#windows)) {
+    $windows[$idx]->unmap;
+}
+sync_with_i3;
+
+is(scalar @{get_ws_content($tmp)}, $count / 2, 'half of the windows closed');
+
+cmd '[id="' . $windows[1]->id . '"] focus';
+is($x->input_focus, $windows[1]->id, 'remaining window can be focused');
+
+kill_all_windows;
+
+is(scalar @{get_ws_content($tmp)}, 0, 'all windows closed');
+
+done_testing;
@@ -0,0 +1,65 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies the GET_TREE_CHANGES IPC message.
+use i3test;
+use List::Util qw(first);
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+# TODO: use the symbolic name for the command/reply type instead of the
+# numerical 13:
+sub get_tree_changes {
+    my ($since) = @_;
+    return $i3->message(13, "$since")->recv;
+}
+
+my $ws = fresh_workspace;
+
+my $changes = get_tree_changes(0);
+ok($changes->{complete}, 'generation 0 returns the complete tree');
+ok(defined(first { $_->{type} eq 'root' } @{$changes->{nodes}}), 'root container included');
+my $generation = $changes->{generation};
+
+$changes = get_tree_changes($generation);
+ok(!$changes->{complete}, 'known generation returns only changes');
+is($changes->{generation}, $generation, 'generation unchanged without changes');
+is(scalar @{$changes->{nodes}}, 0, 'no containers changed');
+
+my $window = open_window;
+
+$changes = get_tree_changes($generation);
+ok($changes->{generation} > $generation, 'opening a window starts a new generation');
+my $con = first { defined($_->{window}) && $_->{window} == $window->id } @{$changes->{nodes}};
+ok(defined($con), 'new window container included');
+my $ws_con = first { $_->{type} eq 'workspace' && $_->{name} eq $ws } @{$changes->{nodes}};
+ok(defined($ws_con), 'workspace included');
+is_deeply($ws_con->{nodes}, [ $con->{id} ], 'children are listed by their ID');
+ok(!defined(first { $_->{type} eq 'root' } @{$changes->{nodes}}), 'unchanged root container not included');
+$generation = $changes->{generation};
+
+cmd 'kill';
+wait_for_unmap $window;
+
+$changes = get_tree_changes($generation);
+is_deeply($changes->{removed}, [ $con->{id} ], 'closed container removed');
+
+$changes = get_tree_changes($changes->{generation} + 1000);
+ok($changes->{complete}, 'unknown generation returns the complete tree');
+is(scalar @{$changes->{removed}}, 0, 'no removals for the complete tree');
+
+done_testing;
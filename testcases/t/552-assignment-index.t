@@ -0,0 +1,39 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that for_window rules run in configuration order, no matter whether
+# they are indexed by an exact class or instance literal or not.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+for_window [class="^indexed$"] mark --add first
+for_window [class="index"] mark --add second
+for_window [instance="^indexed$"] mark --add third
+for_window [class="^indexed$" title="other"] mark --add wrong_title
+for_window [class="^other$"] mark --add wrong_class
+for_window [class="^indexed$"] mark --add fourth
+EOT
+use List::Util qw(first);
+
+my $ws = fresh_workspace;
+my $window = open_window(wm_class => 'indexed', name => 'some title');
+
+my $con = first { $_->{window} == $window->id } @{get_ws_content($ws)};
+is_deeply($con->{marks}, [ 'first', 'second', 'third', 'fourth' ],
+    'matching rules ran in configuration order');
+
+done_testing;
@@ -0,0 +1,89 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING only contain the
+# managed windows (each of them once) after an in-place restart, even if the
+# previous instance left other windows in them.
+use i3test;
+
+sub get_window_list {
+    my ($name) = @_;
+
+    sync_with_i3;
+
+    my $cookie = $x->get_property(
+        0,
+        $x->get_root_window(),
+        $x->atom(name => $name)->id,
+        $x->atom(name => 'WINDOW')->id,
+        0,
+        4096,
+    );
+    my $reply = $x->get_property_reply($cookie->{sequence});
+    my $len = $reply->{length};
+
+    return () if $len == 0;
+    return unpack("L$len", $reply->{value});
+}
+
+sub is_window_list {
+    my ($name, $expected, $msg) = @_;
+
+    my @windows = get_window_list($name);
+    is_deeply([ sort { $a <=> $b } @windows ],
+              [ sort { $a <=> $b } @$expected ],
+              "$name: $msg");
+}
+
+fresh_workspace;
+
+my $first = open_window;
+my $second = open_window;
+my @expected = ($first->id, $second->id);
+
+is_window_list('_NET_CLIENT_LIST', \@expected, 'both windows before restart');
+is_window_list('_NET_CLIENT_LIST_STACKING', \@expected, 'both windows before restart');
+
+# Leave a window which does not exist in both lists, like a crashed instance
+# would.
+for my $name (qw(_NET_CLIENT_LIST _NET_CLIENT_LIST_STACKING)) {
+    $x->change_property(
+        PROP_MODE_APPEND,
+        $x->get_root_window(),
+        $x->atom(name => $name)->id,
+        $x->atom(name => 'WINDOW')->id,
+        32,
+        1,
+        pack('L', 0x7fffffff),
+    );
+}
+$x->flush;
+
+cmd 'restart';
+
+does_i3_live;
+
+is_window_list('_NET_CLIENT_LIST', \@expected, 'no duplicate or stale windows after restart');
+is_window_list('_NET_CLIENT_LIST_STACKING', \@expected, 'no duplicate or stale windows after restart');
+
+# Windows opened after the restart are appended once.
+my $third = open_window;
+push @expected, $third->id;
+
+is_window_list('_NET_CLIENT_LIST', \@expected, 'new window added once');
+is_window_list('_NET_CLIENT_LIST_STACKING', \@expected, 'new window added once');
+
+done_testing;